@@ -8,20 +8,179 @@
 #define ARGPARSE_H
 
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <bitset>
 #include <cctype>
+#include <cerrno>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
 #include <cstring>
+#include <functional>
 #include <iomanip>
 #include <iostream>
+#include <limits>
 #include <locale>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <numeric>
 #include <sstream>
 #include <stdexcept>
 #include <string>
+#include <thread>
 #include <unordered_map>
 #include <vector>
 
+// POSIX systems map files into memory and ask the terminal for its size
+#if !defined(ARGPARSE_POSIX) && (defined(__unix__) || defined(__APPLE__))
+#define ARGPARSE_POSIX 1
+#endif
+
+#ifdef ARGPARSE_POSIX
+#include <fcntl.h>
+#include <locale.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef __APPLE__
+#include <xlocale.h>
+#endif
+#else
+#include <fstream>
+#include <iterator>
+#endif
+#ifdef _WIN32
+#include <locale.h>
+#endif
+
+// eight digits are read as one little endian word
+#if (defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__) || \
+    defined(_M_X64) || defined(_M_IX86) || defined(_M_ARM64)
+#define ARGPARSE_SWAR_DIGITS 1
+#endif
+
 namespace argparse {
+// Non-owning reference to a run of characters, used so argument values can
+// slice command line tokens instead of copying them. A view is only valid for
+// as long as the characters it points at.
+class StringView {
+ public:
+  static constexpr size_t npos = static_cast<size_t>(-1);
+
+  StringView() {}
+  StringView(const char *data, size_t size) : _data(data), _size(size) {}
+  StringView(const char *s) : _data(s), _size(s ? std::strlen(s) : 0) {}
+  StringView(const std::string &s) : _data(s.data()), _size(s.size()) {}
+
+  const char *data() const { return _data; }
+  size_t size() const { return _size; }
+  size_t length() const { return _size; }
+  bool empty() const { return _size == 0; }
+  const char *begin() const { return _data; }
+  const char *end() const { return _data + _size; }
+  char operator[](size_t i) const { return _data[i]; }
+
+  StringView substr(size_t pos, size_t n = npos) const {
+    if (pos > _size) {
+      pos = _size;
+    }
+    return StringView(_data + pos, std::min(n, _size - pos));
+  }
+
+  std::string str() const { return std::string(_data, _size); }
+  operator std::string() const { return str(); }
+
+  friend bool operator==(const StringView &a, const StringView &b) {
+    return a._size == b._size &&
+           (a._size == 0 || std::memcmp(a._data, b._data, a._size) == 0);
+  }
+  friend bool operator!=(const StringView &a, const StringView &b) {
+    return !(a == b);
+  }
+  friend bool operator<(const StringView &a, const StringView &b) {
+    size_t n = std::min(a._size, b._size);
+    int c = n == 0 ? 0 : std::memcmp(a._data, b._data, n);
+    return c < 0 || (c == 0 && a._size < b._size);
+  }
+  friend std::ostream &operator<<(std::ostream &os, const StringView &s) {
+    os.write(s._data, static_cast<std::streamsize>(s._size));
+    return os;
+  }
+
+ private:
+  const char *_data{nullptr};
+  size_t _size{0};
+};
+
+// Monotonic memory for the values of one parse at a time. Memory comes from
+// a buffer supplied by the caller, such as one on the stack, and from heap
+// blocks once that runs out. Nothing is freed on its own; release() makes
+// all of it available again at once and keeps the heap blocks for reuse.
+class Arena {
+ public:
+  explicit Arena(size_t block_size = 4096) : _block_size(block_size) {}
+
+  Arena(void *buffer, size_t size, size_t block_size = 4096)
+      : _block_size(block_size) {
+    _blocks.push_back({static_cast<char *>(buffer), size});
+  }
+
+  Arena(const Arena &) = delete;
+  Arena &operator=(const Arena &) = delete;
+
+  void *allocate(size_t size, size_t align = alignof(std::max_align_t)) {
+    for (;;) {
+      if (_block < _blocks.size()) {
+        block &b = _blocks[_block];
+        uintptr_t p = reinterpret_cast<uintptr_t>(b.data) + _used;
+        size_t pad = (align - p % align) % align;
+        if (pad + size <= b.size - _used) {
+          _used += pad + size;
+          return b.data + (_used - size);
+        }
+        ++_block;
+        _used = 0;
+      } else {
+        size_t n = std::max(_block_size, size + align);
+        _owned.emplace_back(new char[n]);
+        _blocks.push_back({_owned.back().get(), n});
+        _reserved += n;
+      }
+    }
+  }
+
+  void release() {
+    _block = 0;
+    _used = 0;
+  }
+
+  // Heap memory the arena holds, its heap blocks and the lists of blocks;
+  // the caller's buffer is not included
+  size_t reserved_bytes() const {
+    return _reserved + _blocks.capacity() * sizeof(block) +
+           _owned.capacity() * sizeof(_owned[0]);
+  }
+
+ private:
+  struct block {
+    char *data;
+    size_t size;
+  };
+  size_t _block_size;
+  std::vector<block> _blocks{};
+  std::vector<std::unique_ptr<char[]>> _owned{};
+  // total size of the heap blocks
+  size_t _reserved{0};
+  size_t _block{0};
+  size_t _used{0};
+};
+
 namespace detail {
 static inline bool _not_space(int ch) { return !std::isspace(ch); }
 static inline void _ltrim(std::string &s, bool (*f)(int) = _not_space) {
@@ -62,14 +221,44 @@ static inline std::string _join(InputIt begin, InputIt end,
   }
   return ss.str();
 }
-static inline bool _is_number(const std::string &arg) {
-  std::istringstream iss(arg);
-  float f;
-  iss >> std::noskipws >> f;
-  return iss.eof() && !iss.fail();
+// matches what reading a float from a stream accepts:
+// [+-](digits[.digits]|.digits)[(e|E)[+-]digits]
+static inline bool _is_number(StringView arg) {
+  size_t i = 0;
+  size_t n = arg.size();
+  if (i < n && (arg[i] == '+' || arg[i] == '-')) {
+    ++i;
+  }
+  size_t digits = 0;
+  for (; i < n && std::isdigit(static_cast<unsigned char>(arg[i])); ++i) {
+    ++digits;
+  }
+  if (i < n && arg[i] == '.') {
+    for (++i; i < n && std::isdigit(static_cast<unsigned char>(arg[i])); ++i) {
+      ++digits;
+    }
+  }
+  if (digits == 0) {
+    return false;
+  }
+  if (i < n && (arg[i] == 'e' || arg[i] == 'E')) {
+    ++i;
+    if (i < n && (arg[i] == '+' || arg[i] == '-')) {
+      ++i;
+    }
+    if (i == n) {
+      return false;
+    }
+    for (; i < n; ++i) {
+      if (!std::isdigit(static_cast<unsigned char>(arg[i]))) {
+        return false;
+      }
+    }
+  }
+  return i == n;
 }
 
-static inline int _find_equal(const std::string &s) {
+static inline int _find_equal(StringView s) {
   for (size_t i = 0; i < s.length(); ++i) {
     // if find graph symbol before equal, end search
     // i.e. don't accept --asd)f=0 arguments
@@ -86,466 +275,3450 @@ static inline int _find_equal(const std::string &s) {
   return -1;
 }
 
-static inline size_t _find_name_end(const std::string &s) {
+static inline size_t _find_name_end(StringView s) {
   size_t i;
   for (i = 0; i < s.length(); ++i) {
-    if (std::ispunct(static_cast<int>(s[i]))) {
+    // names may contain - and _, as allowed by _find_equal
+    if (std::ispunct(static_cast<int>(s[i])) && s[i] != '_' && s[i] != '-') {
       break;
     }
   }
   return i;
 }
 
-namespace is_vector_impl {
-template <typename T>
-struct is_vector : std::false_type {};
-template <typename... Args>
-struct is_vector<std::vector<Args...>> : std::true_type {};
-}  // namespace is_vector_impl
+// FNV-1a, usable at compile time on string literals and at run time on views
+static constexpr uint32_t _hash(const char *s, uint32_t h = 2166136261u) {
+  return *s ? _hash(s + 1, static_cast<uint32_t>(
+                               (h ^ static_cast<unsigned char>(*s)) *
+                               16777619u))
+            : h;
+}
+static inline uint32_t _hash(StringView s) {
+  uint32_t h = 2166136261u;
+  for (size_t i = 0; i < s.size(); ++i) {
+    h ^= static_cast<unsigned char>(s[i]);
+    h *= 16777619u;
+  }
+  return h;
+}
+static constexpr size_t _length(const char *s) {
+  return *s ? 1 + _length(s + 1) : 0;
+}
+static constexpr const char *_skip_dashes(const char *s) {
+  return *s == '-' ? _skip_dashes(s + 1) : s;
+}
+static constexpr size_t _next_pow2(size_t n, size_t p = 1) {
+  return p >= n ? p : _next_pow2(n, p * 2);
+}
 
-// type trait to utilize the implementation type traits as well as decay the
-// type
-template <typename T>
-struct is_vector {
-  static constexpr bool const value =
-      is_vector_impl::is_vector<typename std::decay<T>::type>::value;
-};
-}  // namespace detail
+// view of a name with any leading dashes removed
+static inline StringView _strip_dashes(StringView s) {
+  size_t i = 0;
+  while (i < s.size() && s[i] == '-') {
+    ++i;
+  }
+  return s.substr(i);
+}
 
-class ArgumentParser {
- private:
+// view with leading and trailing whitespace removed
+static inline StringView _trim(StringView s) {
+  size_t begin = 0;
+  size_t end = s.size();
+  while (begin < end && std::isspace(static_cast<unsigned char>(s[begin]))) {
+    ++begin;
+  }
+  while (end > begin && std::isspace(static_cast<unsigned char>(s[end - 1]))) {
+    --end;
+  }
+  return s.substr(begin, end - begin);
+}
+
+// Open addressing hash table mapping argument names to argument indices. The
+// keys are copied into a single buffer owned by the table and the hash of
+// every key is kept next to it, so a lookup is a probe over a flat array and
+// never allocates.
+class name_index {
  public:
-  class Argument;
+  void clear() {
+    _slots.assign(_slots.size(), slot());
+    _keys.clear();
+    _size = 0;
+  }
 
-  class Result {
-   public:
-    Result() {}
-    Result(std::string err) noexcept : _error(true), _what(err) {}
+  // returns false if the key is already present
+  bool insert(StringView key, int value) {
+    if ((_size + 1) * 2 > _slots.size()) {
+      _grow();
+    }
+    uint32_t h = _hash(key);
+    size_t i = _probe(key, h);
+    if (_slots[i].value >= 0) {
+      return false;
+    }
+    _slots[i].hash = h;
+    _slots[i].offset = _keys.size();
+    _slots[i].length = key.size();
+    _slots[i].value = value;
+    _keys.append(key.data(), key.size());
+    ++_size;
+    return true;
+  }
 
-    operator bool() const { return _error; }
+  // returns -1 if the key is not present
+  int find(StringView key) const {
+    if (_size == 0) {
+      return -1;
+    }
+    return _slots[_probe(key, _hash(key))].value;
+  }
 
-    friend std::ostream &operator<<(std::ostream &os, const Result &dt);
+  size_t size() const { return _size; }
 
-    const std::string &what() const { return _what; }
+  size_t retained_bytes() const {
+    return _slots.capacity() * sizeof(slot) + _keys.capacity();
+  }
 
-   private:
-    bool _error{false};
-    std::string _what{};
+ private:
+  struct slot {
+    uint32_t hash{0};
+    int value{-1};
+    size_t offset{0};
+    size_t length{0};
   };
 
-  class Argument {
-   public:
-    enum Position : int { LAST = -1, DONT_CARE = -2 };
-    enum Count : int { ANY = -1 };
-
-    Argument &name(const std::string &name) {
-      _names.push_back(name);
-      return *this;
-    }
-
-    Argument &names(std::vector<std::string> names) {
-      _names.insert(_names.end(), names.begin(), names.end());
-      return *this;
-    }
-
-    Argument &description(const std::string &description) {
-      _desc = description;
-      return *this;
-    }
-
-    Argument &required(bool req) {
-      _required = req;
-      return *this;
+  // index of the slot holding key, or of the empty slot where it would go
+  size_t _probe(StringView key, uint32_t h) const {
+    size_t mask = _slots.size() - 1;
+    size_t i = h & mask;
+    while (_slots[i].value >= 0) {
+      const slot &s = _slots[i];
+      if (s.hash == h && s.length == key.size() &&
+          std::memcmp(_keys.data() + s.offset, key.data(), key.size()) == 0) {
+        break;
+      }
+      i = (i + 1) & mask;
     }
+    return i;
+  }
 
-    Argument &position(int position) {
-      if (position != Position::LAST) {
-        // position + 1 because technically argument zero is the name of the
-        // executable
-        _position = position + 1;
-      } else {
-        _position = position;
+  void _grow() {
+    std::vector<slot> old;
+    old.swap(_slots);
+    _slots.resize(old.empty() ? 16 : old.size() * 2);
+    size_t mask = _slots.size() - 1;
+    for (auto &s : old) {
+      if (s.value >= 0) {
+        size_t i = s.hash & mask;
+        while (_slots[i].value >= 0) {
+          i = (i + 1) & mask;
+        }
+        _slots[i] = s;
       }
-      return *this;
     }
+  }
 
-    Argument &count(int count) {
-      _count = count;
-      return *this;
-    }
+  std::vector<slot> _slots{};
+  std::string _keys{};
+  size_t _size{0};
+};
 
-    bool found() const { return _found; }
+// Levenshtein distance from one pattern of up to 64 characters to any
+// number of texts, computed bit-parallel (Myers, in Hyyro's formulation):
+// a column of the distance matrix is held in two words of vertical deltas,
+// so each character of the text costs a few word operations whatever the
+// pattern's length.
+class edit_distance {
+ public:
+  static constexpr size_t max_pattern = 64;
 
-    template <typename T>
-    typename std::enable_if<detail::is_vector<T>::value, T>::type get() {
-      T t = T();
-      typename T::value_type vt;
-      for (auto &s : _values) {
-        std::istringstream in(s);
-        in >> vt;
-        t.push_back(vt);
-      }
-      return t;
+  explicit edit_distance(StringView pattern) : _size(pattern.size()) {
+    for (size_t i = 0; i < pattern.size() && i < max_pattern; ++i) {
+      _peq[static_cast<unsigned char>(pattern[i])] |= uint64_t(1) << i;
     }
+  }
 
-    template <typename T>
-    typename std::enable_if<!detail::is_vector<T>::value, T>::type get() {
-      std::istringstream in(get<std::string>());
-      T t = T();
-      in >> t >> std::ws;
-      return t;
+  // distance to text, or bound + 1 as soon as it is certain to exceed bound
+  size_t operator()(StringView text, size_t bound) const {
+    size_t n = text.size();
+    if (_size == 0 || _size > max_pattern) {
+      return _size == 0 ? std::min(n, bound + 1) : bound + 1;
     }
-
-   private:
-    Argument(const std::string &name, const std::string &desc,
-             bool required = false)
-        : _desc(desc), _required(required) {
-      _names.push_back(name);
+    if ((n > _size ? n - _size : _size - n) > bound) {
+      return bound + 1;
     }
+    const uint64_t high = uint64_t(1) << (_size - 1);
+    uint64_t pv = ~uint64_t(0);
+    uint64_t mv = 0;
+    size_t score = _size;
+    for (size_t j = 0; j < n; ++j) {
+      uint64_t eq = _peq[static_cast<unsigned char>(text[j])];
+      uint64_t xv = eq | mv;
+      uint64_t xh = (((eq & pv) + pv) ^ pv) | eq;
+      uint64_t ph = mv | ~(xh | pv);
+      uint64_t mh = pv & xh;
+      if (ph & high) {
+        ++score;
+      } else if (mh & high) {
+        --score;
+      }
+      // the rest of the text can lower the score by one per character
+      if (score > bound + (n - j - 1)) {
+        return bound + 1;
+      }
+      ph = (ph << 1) | 1;
+      mh <<= 1;
+      pv = mh | ~(xv | ph);
+      mv = ph & xv;
+    }
+    return std::min(score, bound + 1);
+  }
 
-    Argument() {}
-
-    friend class ArgumentParser;
-    int _position{Position::DONT_CARE};
-    int _count{Count::ANY};
-    std::vector<std::string> _names{};
-    std::string _desc{};
-    bool _found{false};
-    bool _required{false};
-    int _index{-1};
-
-    std::vector<std::string> _values{};
-  };
+ private:
+  std::array<uint64_t, 256> _peq{};
+  size_t _size;
+};
 
-  ArgumentParser(const std::string &bin, const std::string &desc)
-      : _bin(bin), _desc(desc) {}
+// Largest edit distance at which a name is offered for a mistyped one of
+// the given length
+static inline size_t _suggestion_bound(size_t length) {
+  return std::min<size_t>(3, 1 + length / 4);
+}
 
-  Argument &add_argument() {
-    _arguments.push_back({});
-    _arguments.back()._index = static_cast<int>(_arguments.size()) - 1;
-    return _arguments.back();
-  }
+static inline size_t _popcount(uint64_t x) {
+  x = x - ((x >> 1) & 0x5555555555555555u);
+  x = (x & 0x3333333333333333u) + ((x >> 2) & 0x3333333333333333u);
+  x = (x + (x >> 4)) & 0x0f0f0f0f0f0f0f0fu;
+  return static_cast<size_t>((x * 0x0101010101010101u) >> 56);
+}
 
-  Argument &add_argument(const std::string &name, const std::string &long_name,
-                         const std::string &desc, const bool required = false) {
-    _arguments.push_back(Argument(name, desc, required));
-    _arguments.back()._names.push_back(long_name);
-    _arguments.back()._index = static_cast<int>(_arguments.size()) - 1;
-    return _arguments.back();
+// One bit for each character text contains: letters, digits, - and _ get
+// bits of their own, everything else shares the last one
+static inline uint64_t _signature(StringView text) {
+  uint64_t signature = 0;
+  for (char ch : text) {
+    unsigned c = static_cast<unsigned char>(ch);
+    unsigned bit = c >= 'a' && c <= 'z'   ? c - 'a'
+                   : c >= 'A' && c <= 'Z' ? c - 'A' + 26
+                   : c >= '0' && c <= '9' ? c - '0' + 52
+                   : c == '-' || c == '_' ? 62
+                                          : 63;
+    signature |= uint64_t(1) << bit;
   }
+  return signature;
+}
 
-  Argument &add_argument(const std::string &name, const std::string &desc,
-                         const bool required = false) {
-    _arguments.push_back(Argument(name, desc, required));
-    _arguments.back()._index = static_cast<int>(_arguments.size()) - 1;
-    return _arguments.back();
+// Names to suggest for mistyped ones, bucketed by length and each with the
+// signature of its characters. An edit changes the length by at most one
+// and flips at most two bits of the signature, so a name further off in
+// either than the distance still allowed is skipped without running
+// edit_distance on it. Lengths nearest the typed one are searched first,
+// and every name found tightens the bound for the rest.
+class suggestion_index {
+ public:
+  // name is matched without its leading dashes and suggested with them
+  void add(StringView name) {
+    StringView match = _strip_dashes(name);
+    _entries.push_back({_chars.size(), name.size(), name.size() - match.size(),
+                        _signature(match)});
+    _chars.append(name.data(), name.size());
   }
 
-  void print_help(size_t count = 0, size_t page = 0) {
-    if (page * count > _arguments.size()) {
-      return;
+  // Sorts the names into their buckets, keeping the order they were added
+  // in within each, once they have all been added
+  void build() {
+    size_t longest = 0;
+    for (auto &e : _entries) {
+      longest = std::max(longest, e.match_size());
     }
-    if (page == 0) {
-      std::cout << "Usage: " << _bin;
-      if (_positional_arguments.empty()) {
-        std::cout << " [options...]" << std::endl;
-      } else {
-        int current = 1;
-        for (auto &v : _positional_arguments) {
-          if (v.first != Argument::Position::LAST) {
-            for (; current < v.first; current++) {
-              std::cout << " [" << current << "]";
-            }
-            std::cout
-                << " ["
-                << detail::_ltrim_copy(
-                       _arguments[static_cast<size_t>(v.second)]._names[0],
-                       [](int c) -> bool { return c != static_cast<int>('-'); })
-                << "]";
-          }
-        }
-        auto it = _positional_arguments.find(Argument::Position::LAST);
-        if (it == _positional_arguments.end()) {
-          std::cout << " [options...]";
-        } else {
-          std::cout
-              << " [options...] ["
-              << detail::_ltrim_copy(
-                     _arguments[static_cast<size_t>(it->second)]._names[0],
-                     [](int c) -> bool { return c != static_cast<int>('-'); })
-              << "]";
-        }
-        std::cout << std::endl;
-      }
-      std::cout << "Options:" << std::endl;
+    _first.assign(longest + 2, 0);
+    for (auto &e : _entries) {
+      ++_first[e.match_size() + 1];
     }
-    if (count == 0) {
-      page = 0;
-      count = _arguments.size();
+    std::partial_sum(_first.begin(), _first.end(), _first.begin());
+    std::vector<entry> sorted(_entries.size());
+    std::vector<size_t> next(_first.begin(), _first.end() - 1);
+    for (auto &e : _entries) {
+      sorted[next[e.match_size()]++] = e;
     }
-    for (size_t i = page * count;
-         i < std::min<size_t>(page * count + count, _arguments.size()); i++) {
-      Argument &a = _arguments[i];
-      std::string name = a._names[0];
-      for (size_t n = 1; n < a._names.size(); ++n) {
-        name.append(", " + a._names[n]);
-      }
-      std::cout << "    " << std::setw(23) << std::left << name << std::setw(23)
-                << a._desc;
-      if (a._required) {
-        std::cout << " (Required)";
-      }
-      std::cout << std::endl;
+    _entries.swap(sorted);
+    _signatures.resize(_entries.size());
+    for (size_t i = 0; i < _entries.size(); ++i) {
+      _signatures[i] = _entries[i].signature;
     }
   }
 
-  Result parse(int argc, const char *argv[]) {
-    Result err;
-    if (argc > 1) {
-      // build name map
-      for (auto &a : _arguments) {
-        for (auto &n : a._names) {
-          std::string name = detail::_ltrim_copy(
-              n, [](int c) -> bool { return c != static_cast<int>('-'); });
-          if (_name_map.find(name) != _name_map.end()) {
-            return Result("Duplicate of argument name: " + n);
-          }
-          _name_map[name] = a._index;
-        }
-        if (a._position >= 0 || a._position == Argument::Position::LAST) {
-          _positional_arguments[a._position] = a._index;
+  // Closest name to text within _suggestion_bound, with its dashes, or an
+  // empty string. Ties go to the name whose length is nearest, then to the
+  // shorter one, then to the one added first.
+  std::string closest(StringView text) const {
+    edit_distance distance(text);
+    uint64_t signature = _signature(text);
+    size_t n = text.size();
+    size_t limit = _suggestion_bound(n);
+    const entry *best = nullptr;
+    for (size_t delta = 0; delta <= limit; ++delta) {
+      for (size_t side = 0; side < 2 && delta <= limit; ++side) {
+        if ((side == 0 && delta > n) || (side == 1 && delta == 0)) {
+          continue;
         }
-      }
-      if (err) {
-        return err;
-      }
-
-      // parse
-      std::string current_arg;
-      size_t arg_len;
-      for (int argv_index = 1; argv_index < argc; ++argv_index) {
-        current_arg = std::string(argv[argv_index]);
-        arg_len = current_arg.length();
-        if (arg_len == 0) {
+        size_t length = side == 0 ? n - delta : n + delta;
+        if (length + 1 >= _first.size()) {
           continue;
         }
-        if (_help_enabled && (current_arg == "-h" || current_arg == "--help")) {
-          _arguments[static_cast<size_t>(_name_map["help"])]._found = true;
-        } else if (argv_index == argc - 1 &&
-                   _positional_arguments.find(Argument::Position::LAST) !=
-                       _positional_arguments.end()) {
-          err = _end_argument();
-          Result b = err;
-          err = _add_value(current_arg, Argument::Position::LAST);
-          if (b) {
-            return b;
-          }
-          if (err) {
-            return err;
+        for (size_t i = _first[length]; i < _first[length + 1]; ++i) {
+          if (_popcount(_signatures[i] ^ signature) > 2 * limit) {
+            continue;
           }
-        } else if (arg_len >= 2 &&
-                   !detail::_is_number(current_arg)) {  // ignores the case if
-                                                        // the arg is just a -
-          // look for -a (short) or --arg (long) args
-          if (current_arg[0] == '-') {
-            err = _end_argument();
-            if (err) {
-              return err;
+          const entry &e = _entries[i];
+          size_t d = distance(
+              StringView(_chars.data() + e.offset + e.dashes, length), limit);
+          if (d <= limit) {
+            best = &e;
+            if (d == 0) {
+              return _name(e);
             }
-            // look for --arg (long) args
-            if (current_arg[1] == '-') {
-              err = _begin_argument(current_arg.substr(2), true, argv_index);
-              if (err) {
-                return err;
-              }
-            } else {  // short args
-              err = _begin_argument(current_arg.substr(1), false, argv_index);
-              if (err) {
-                return err;
-              }
-            }
-          } else {  // argument value
-            err = _add_value(current_arg, argv_index);
-            if (err) {
-              return err;
-            }
-          }
-        } else {  // argument value
-          err = _add_value(current_arg, argv_index);
-          if (err) {
-            return err;
-          }
-        }
-      }
-    }
-    if (_help_enabled && exists("help")) {
-      return Result();
-    }
-    err = _end_argument();
-    if (err) {
-      return err;
-    }
-    for (auto &p : _positional_arguments) {
-      Argument &a = _arguments[static_cast<size_t>(p.second)];
-      if (a._values.size() > 0 && a._values[0][0] == '-') {
-        std::string name = detail::_ltrim_copy(a._values[0], [](int c) -> bool {
-          return c != static_cast<int>('-');
-        });
-        if (_name_map.find(name) != _name_map.end()) {
-          if (a._position == Argument::Position::LAST) {
-            return Result(
-                "Poisitional argument expected at the end, but argument " +
-                a._values[0] + " found instead");
-          } else {
-            return Result("Poisitional argument expected in position " +
-                          std::to_string(a._position) + ", but argument " +
-                          a._values[0] + " found instead");
+            limit = d - 1;
           }
         }
       }
     }
-    for (auto &a : _arguments) {
-      if (a._required && !a._found) {
-        return Result("Required argument not found: " + a._names[0]);
-      }
-      if (a._position >= 0 && argc >= a._position && !a._found) {
-        return Result("Argument " + a._names[0] + " expected in position " +
-                      std::to_string(a._position));
-      }
-    }
-    return Result();
+    return best ? _name(*best) : std::string();
   }
 
-  void enable_help() {
-    add_argument("-h", "--help", "Shows this page", false);
-    _help_enabled = true;
+  size_t retained_bytes() const {
+    return _entries.capacity() * sizeof(entry) +
+           _signatures.capacity() * sizeof(uint64_t) +
+           _first.capacity() * sizeof(size_t) + _chars.capacity();
   }
 
-  bool exists(const std::string &name) const {
-    std::string n = detail::_ltrim_copy(
-        name, [](int c) -> bool { return c != static_cast<int>('-'); });
-    auto it = _name_map.find(n);
-    if (it != _name_map.end()) {
-      return _arguments[static_cast<size_t>(it->second)]._found;
+ private:
+  struct entry {
+    size_t offset;
+    size_t size;
+    size_t dashes;
+    uint64_t signature;
+    size_t match_size() const { return size - dashes; }
+  };
+
+  std::string _name(const entry &e) const {
+    return std::string(_chars.data() + e.offset, e.size);
+  }
+
+  std::vector<entry> _entries{};
+  // the entries' signatures again, packed for the scan that filters them
+  std::vector<uint64_t> _signatures{};
+  // entries of length l, without dashes, are [_first[l], _first[l + 1])
+  std::vector<size_t> _first{};
+  std::string _chars{};
+};
+
+// Adds the time between its construction and destruction to *total, doing
+// nothing, not even reading the clock, when total is null
+class stopwatch {
+ public:
+  explicit stopwatch(std::chrono::nanoseconds *total) : _total(total) {
+    if (_total) {
+      _start = std::chrono::steady_clock::now();
+    }
+  }
+  stopwatch(const stopwatch &) = delete;
+  stopwatch &operator=(const stopwatch &) = delete;
+
+  ~stopwatch() {
+    if (_total) {
+      *_total += std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now() - _start);
+    }
+  }
+
+ private:
+  std::chrono::nanoseconds *_total;
+  std::chrono::steady_clock::time_point _start{};
+};
+
+// Conversion of argument values to typed values. Arithmetic types are parsed
+// directly from the characters of the value without going through a stream:
+// integers accept an optional sign, 0x/0o/0b prefixes and _ between digits
+// and are checked for overflow, and floating point values accept _ between
+// digits. Other types fall back to reading from an istringstream.
+enum conversion_error : int {
+  CONVERSION_OK = 0,
+  CONVERSION_INVALID = 1,
+  CONVERSION_OUT_OF_RANGE = 2
+};
+
+template <typename T>
+struct is_character
+    : std::integral_constant<
+          bool, std::is_same<T, char>::value ||
+                    std::is_same<T, wchar_t>::value ||
+                    std::is_same<T, char16_t>::value ||
+                    std::is_same<T, char32_t>::value> {};
+
+// types converted by the parsing engine rather than by a stream, signed and
+// unsigned char are treated as the 8 bit integers they are used for
+template <typename T>
+struct is_number
+    : std::integral_constant<bool, std::is_arithmetic<T>::value &&
+                                       !is_character<T>::value> {};
+
+// Whether the 8 characters at p are all decimal digits, and their value,
+// each worked out on the 8 characters at once as one 64 bit word
+static inline bool _is_eight_digits(const char *p) {
+#ifdef ARGPARSE_SWAR_DIGITS
+  uint64_t v;
+  std::memcpy(&v, p, 8);
+  return ((v & 0xF0F0F0F0F0F0F0F0) |
+          (((v + 0x0606060606060606) & 0xF0F0F0F0F0F0F0F0) >> 4)) ==
+         0x3333333333333333;
+#else
+  (void)p;
+  return false;
+#endif
+}
+
+static inline uint32_t _eight_digits(const char *p) {
+  uint64_t v;
+  std::memcpy(&v, p, 8);
+  v -= 0x3030303030303030;
+  // pairs of digits, then groups of four, then all eight
+  v = v * 10 + (v >> 8);
+  v = ((v & 0x000000FF000000FF) * (100 + (1000000ULL << 32)) +
+       ((v >> 16) & 0x000000FF000000FF) * (1 + (10000ULL << 32))) >>
+      32;
+  return static_cast<uint32_t>(v);
+}
+
+static inline unsigned _digit_value(char c) {
+  if (c >= '0' && c <= '9') {
+    return static_cast<unsigned>(c - '0');
+  } else if (c >= 'a' && c <= 'z') {
+    return static_cast<unsigned>(c - 'a') + 10;
+  } else if (c >= 'A' && c <= 'Z') {
+    return static_cast<unsigned>(c - 'A') + 10;
+  }
+  return 255;
+}
+
+template <typename T>
+static inline typename std::enable_if<is_number<T>::value &&
+                                          std::is_integral<T>::value &&
+                                          !std::is_same<T, bool>::value,
+                                      conversion_error>::type
+_convert(StringView s, T &out) {
+  size_t i = 0;
+  size_t n = s.size();
+  bool negative = false;
+  if (i < n && (s[i] == '+' || s[i] == '-')) {
+    negative = s[i] == '-';
+    ++i;
+  }
+  if (negative && !std::is_signed<T>::value) {
+    return CONVERSION_INVALID;
+  }
+  unsigned base = 10;
+  if (n - i > 2 && s[i] == '0') {
+    char prefix = s[i + 1];
+    if (prefix == 'x' || prefix == 'X') {
+      base = 16;
+    } else if (prefix == 'o' || prefix == 'O') {
+      base = 8;
+    } else if (prefix == 'b' || prefix == 'B') {
+      base = 2;
+    }
+    if (base != 10) {
+      i += 2;
+    }
+  }
+  uintmax_t limit = static_cast<uintmax_t>(std::numeric_limits<T>::max()) +
+                    (negative ? 1 : 0);
+  uintmax_t value = 0;
+  bool digits = false;
+  bool separator = false;
+  bool overflow = false;
+  for (; i < n; ++i) {
+    if (base == 10 && n - i >= 8 && _is_eight_digits(s.data() + i)) {
+      uintmax_t d = _eight_digits(s.data() + i);
+      if (d > limit || value > (limit - d) / 100000000) {
+        overflow = true;
+      } else {
+        value = value * 100000000 + d;
+      }
+      digits = true;
+      separator = false;
+      i += 7;
+      continue;
+    }
+    if (s[i] == '_') {
+      if (!digits || separator) {
+        return CONVERSION_INVALID;
+      }
+      separator = true;
+      continue;
+    }
+    unsigned d = _digit_value(s[i]);
+    if (d >= base) {
+      return CONVERSION_INVALID;
+    }
+    if (value > (limit - d) / base) {
+      overflow = true;
+    } else {
+      value = value * base + d;
+    }
+    digits = true;
+    separator = false;
+  }
+  if (!digits || separator) {
+    return CONVERSION_INVALID;
+  }
+  if (overflow) {
+    return CONVERSION_OUT_OF_RANGE;
+  }
+  if (negative && value > 0) {
+    // value - 1 always fits in T, even for the most negative value
+    out = static_cast<T>(-static_cast<T>(value - 1) - 1);
+  } else {
+    out = static_cast<T>(value);
+  }
+  return CONVERSION_OK;
+}
+
+static inline conversion_error _convert(StringView s, bool &out) {
+  if (s == "1" || s == "true") {
+    out = true;
+  } else if (s == "0" || s == "false") {
+    out = false;
+  } else {
+    return CONVERSION_INVALID;
+  }
+  return CONVERSION_OK;
+}
+
+// strtod and its siblings read the decimal point of the current locale, so
+// values are converted in the C locale whatever the program has set: on
+// POSIX by switching the calling thread's locale around the call, on
+// Windows through the _l variants
+#ifdef ARGPARSE_POSIX
+class c_numeric_locale {
+ public:
+  c_numeric_locale() : _previous(uselocale(_c())) {}
+  c_numeric_locale(const c_numeric_locale &) = delete;
+  c_numeric_locale &operator=(const c_numeric_locale &) = delete;
+  ~c_numeric_locale() { uselocale(_previous); }
+
+ private:
+  static locale_t _c() {
+    static const locale_t c = newlocale(LC_NUMERIC_MASK, "C", locale_t());
+    return c;
+  }
+
+  locale_t _previous;
+};
+
+static inline float _strto(const char *s, char **end, float) {
+  return std::strtof(s, end);
+}
+static inline double _strto(const char *s, char **end, double) {
+  return std::strtod(s, end);
+}
+static inline long double _strto(const char *s, char **end, long double) {
+  return std::strtold(s, end);
+}
+#else
+class c_numeric_locale {};
+
+#ifdef _WIN32
+static inline _locale_t _c_locale() {
+  static const _locale_t c = _create_locale(LC_NUMERIC, "C");
+  return c;
+}
+static inline float _strto(const char *s, char **end, float) {
+  return _strtof_l(s, end, _c_locale());
+}
+static inline double _strto(const char *s, char **end, double) {
+  return _strtod_l(s, end, _c_locale());
+}
+static inline long double _strto(const char *s, char **end, long double) {
+  return _strtold_l(s, end, _c_locale());
+}
+#else
+static inline float _strto(const char *s, char **end, float) {
+  return std::strtof(s, end);
+}
+static inline double _strto(const char *s, char **end, double) {
+  return std::strtod(s, end);
+}
+static inline long double _strto(const char *s, char **end, long double) {
+  return std::strtold(s, end);
+}
+#endif
+#endif
+
+// Reads plain decimals such as -12.375 whose digits fit in the mantissa of
+// T and whose power of ten is exact in T. Dividing two exact values rounds
+// once, so the result is the one strtod gives. Returns false, leaving out
+// alone, for anything else.
+template <typename T>
+static inline bool _convert_decimal(StringView s, T &out) {
+#if defined(FLT_EVAL_METHOD) && FLT_EVAL_METHOD == 0
+  static const double powers[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,
+                                  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+                                  1e12, 1e13, 1e14, 1e15, 1e16, 1e17,
+                                  1e18, 1e19, 1e20, 1e21, 1e22};
+  // largest k for which 5^k, and so 10^k, fits in the mantissa
+  const size_t exact = std::numeric_limits<T>::digits == 53   ? 22
+                       : std::numeric_limits<T>::digits == 24 ? 10
+                                                              : 0;
+  if (exact == 0) {
+    return false;
+  }
+  // only float and double get this far; a variable keeps the shift below
+  // well-formed when long double instantiates this
+  const unsigned digits = exact == 22 ? 53 : 24;
+  size_t i = 0;
+  size_t n = s.size();
+  bool negative = i < n && s[i] == '-';
+  if (i < n && (s[i] == '-' || s[i] == '+')) {
+    ++i;
+  }
+  uint64_t mantissa = 0;
+  size_t count = 0;
+  size_t fraction = 0;
+  bool point = false;
+  while (i < n) {
+    if (n - i >= 8 && count + 8 <= 19 && _is_eight_digits(s.data() + i)) {
+      mantissa = mantissa * 100000000 + _eight_digits(s.data() + i);
+      count += 8;
+      fraction += point ? 8 : 0;
+      i += 8;
+    } else if (s[i] >= '0' && s[i] <= '9' && count < 19) {
+      mantissa = mantissa * 10 + static_cast<unsigned>(s[i] - '0');
+      ++count;
+      fraction += point ? 1 : 0;
+      ++i;
+    } else if (s[i] == '.' && !point) {
+      point = true;
+      ++i;
+    } else {
+      return false;
+    }
+  }
+  if (count == 0 || (point && (fraction == 0 || count == fraction)) ||
+      fraction > exact ||
+      mantissa > (uint64_t(1) << digits)) {
+    return false;
+  }
+  T value = static_cast<T>(mantissa) / static_cast<T>(powers[fraction]);
+  out = negative ? -value : value;
+  return true;
+#else
+  (void)s;
+  (void)out;
+  return false;
+#endif
+}
+
+template <typename T>
+static inline
+    typename std::enable_if<std::is_floating_point<T>::value,
+                            conversion_error>::type
+    _convert(StringView s, T &out) {
+  if (s.empty() || std::isspace(static_cast<unsigned char>(s[0]))) {
+    return CONVERSION_INVALID;
+  }
+  if (_convert_decimal(s, out)) {
+    return CONVERSION_OK;
+  }
+  // strtod needs a terminated string without separators, so copy the value
+  // onto the stack unless it is unusually long
+  char small[64];
+  std::string large;
+  char *buffer = small;
+  if (s.size() >= sizeof(small)) {
+    large.resize(s.size() + 1);
+    buffer = &large[0];
+  }
+  // a separator stands between two digits of the value's base, and only
+  // hexadecimal values after 0x have digits beyond 9
+  size_t sign = s[0] == '-' || s[0] == '+' ? 1 : 0;
+  bool hex = s.size() > sign + 1 && s[sign] == '0' &&
+             (s[sign + 1] == 'x' || s[sign + 1] == 'X');
+  auto digit = [hex](char c) {
+    return hex ? std::isxdigit(static_cast<unsigned char>(c)) != 0
+               : c >= '0' && c <= '9';
+  };
+  size_t length = 0;
+  for (size_t i = 0; i < s.size(); ++i) {
+    if (s[i] == '_') {
+      if (i == 0 || i + 1 == s.size() || !digit(s[i - 1]) ||
+          !digit(s[i + 1])) {
+        return CONVERSION_INVALID;
+      }
+      continue;
+    }
+    buffer[length++] = s[i];
+  }
+  buffer[length] = '\0';
+  char *end = nullptr;
+  T value;
+  int error;
+  {
+    c_numeric_locale c;
+    errno = 0;
+    value = _strto(buffer, &end, T());
+    error = errno;
+  }
+  if (end != buffer + length) {
+    return CONVERSION_INVALID;
+  }
+  if (error == ERANGE && std::isinf(value)) {
+    return CONVERSION_OUT_OF_RANGE;
+  }
+  out = value;
+  return CONVERSION_OK;
+}
+
+static inline conversion_error _convert(StringView s, std::string &out) {
+  out.assign(s.data(), s.size());
+  return CONVERSION_OK;
+}
+
+template <typename T>
+static inline typename std::enable_if<
+    !is_number<T>::value && !std::is_same<T, std::string>::value,
+    conversion_error>::type
+_convert(StringView s, T &out) {
+  std::istringstream in(s.str());
+  in >> out;
+  return in.fail() ? CONVERSION_INVALID : CONVERSION_OK;
+}
+
+// element types converted in bulk into a presized array
+template <typename T>
+struct is_bulk
+    : std::integral_constant<bool, is_number<T>::value &&
+                                       !std::is_same<T, bool>::value> {};
+
+// Converts values[first, last) into out, leaving T() for the values that
+// fail. With checked, stops at the first failure instead. Either way the
+// first failure is returned along with the index of its value.
+template <typename Values, typename T>
+static inline conversion_error _convert_range(const Values &values, T *out,
+                                              size_t first, size_t last,
+                                              bool checked, size_t &index) {
+  conversion_error error = CONVERSION_OK;
+  for (size_t i = first; i < last; ++i) {
+    conversion_error e = _convert(values[i], out[i]);
+    if (e != CONVERSION_OK) {
+      out[i] = T();
+      if (error == CONVERSION_OK) {
+        error = e;
+        index = i;
+      }
+      if (checked) {
+        break;
+      }
+    }
+  }
+  return error;
+}
+
+// _convert_range over all of values, split between up to threads threads
+// when there are enough values to be worth it. The failure reported is
+// the one with the lowest index, as when converting on one thread.
+template <typename Values, typename T>
+static inline conversion_error _convert_all(const Values &values, T *out,
+                                            unsigned threads, bool checked,
+                                            size_t &index) {
+  const size_t min_chunk = 16384;
+  size_t n = values.size();
+  size_t chunks = std::min<size_t>(std::max(threads, 1u), n / min_chunk);
+  if (chunks <= 1) {
+    return _convert_range(values, out, 0, n, checked, index);
+  }
+  std::vector<conversion_error> errors(chunks, CONVERSION_OK);
+  std::vector<size_t> indexes(chunks, 0);
+  std::vector<std::thread> pool;
+  size_t step = n / chunks;
+  for (size_t c = 1; c < chunks; ++c) {
+    size_t last = c + 1 == chunks ? n : (c + 1) * step;
+    pool.emplace_back([&values, out, c, step, last, checked, &errors,
+                       &indexes]() {
+      errors[c] =
+          _convert_range(values, out, c * step, last, checked, indexes[c]);
+    });
+  }
+  errors[0] = _convert_range(values, out, 0, step, checked, indexes[0]);
+  for (auto &t : pool) {
+    t.join();
+  }
+  for (size_t c = 0; c < chunks; ++c) {
+    if (errors[c] != CONVERSION_OK) {
+      index = indexes[c];
+      return errors[c];
+    }
+  }
+  return CONVERSION_OK;
+}
+
+// A file mapped copy-on-write, so its contents can be rewritten in place
+// without touching the file itself. Where mmap is not available the file is
+// read into memory instead.
+class mapped_file {
+ public:
+  mapped_file() {}
+  mapped_file(const mapped_file &) = delete;
+  mapped_file &operator=(const mapped_file &) = delete;
+
+  ~mapped_file() {
+#ifdef ARGPARSE_POSIX
+    if (_data) {
+      munmap(_data, _size);
+    }
+#endif
+  }
+
+  bool open(const std::string &path) {
+#ifdef ARGPARSE_POSIX
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+      ::close(fd);
+      return false;
+    }
+    _device = static_cast<uint64_t>(st.st_dev);
+    _inode = static_cast<uint64_t>(st.st_ino);
+    if (st.st_size > 0) {
+      void *p = mmap(nullptr, static_cast<size_t>(st.st_size),
+                     PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+      if (p == MAP_FAILED) {
+        ::close(fd);
+        return false;
+      }
+      _data = static_cast<char *>(p);
+      _size = static_cast<size_t>(st.st_size);
+    }
+    ::close(fd);
+    return true;
+#else
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+      return false;
+    }
+    _buffer.assign(std::istreambuf_iterator<char>(in),
+                   std::istreambuf_iterator<char>());
+    _data = _buffer.empty() ? nullptr : &_buffer[0];
+    _size = _buffer.size();
+    _path = path;
+    return true;
+#endif
+  }
+
+  bool same_file(const mapped_file &other) const {
+#ifdef ARGPARSE_POSIX
+    return _device == other._device && _inode == other._inode;
+#else
+    return _path == other._path;
+#endif
+  }
+
+  char *data() const { return _data; }
+  size_t size() const { return _size; }
+
+ private:
+  char *_data{nullptr};
+  size_t _size{0};
+#ifdef ARGPARSE_POSIX
+  uint64_t _device{0};
+  uint64_t _inode{0};
+#else
+  std::vector<char> _buffer{};
+  std::string _path{};
+#endif
+};
+
+// Splits the next whitespace separated token off [in, end), removing quotes
+// and backslash escapes in place. Single quotes keep everything up to the
+// closing quote, double quotes still allow escapes. Returns false once only
+// whitespace is left.
+static inline bool _next_token(char *&in, char *end, StringView &token) {
+  while (in != end && std::isspace(static_cast<unsigned char>(*in))) {
+    ++in;
+  }
+  if (in == end) {
+    return false;
+  }
+  char *begin = in;
+  char *out = in;
+  char quote = 0;
+  for (; in != end; ++in) {
+    char c = *in;
+    if (quote) {
+      if (c == quote) {
+        quote = 0;
+        continue;
+      }
+      if (c == '\\' && quote == '"' && in + 1 != end) {
+        c = *++in;
+      }
+    } else if (std::isspace(static_cast<unsigned char>(c))) {
+      break;
+    } else if (c == '\'' || c == '"') {
+      quote = c;
+      continue;
+    } else if (c == '\\' && in + 1 != end) {
+      c = *++in;
+    }
+    *out++ = c;
+  }
+  token = StringView(begin, static_cast<size_t>(out - begin));
+  return true;
+}
+
+// Width of the terminal standard output is connected to, or 0 when it is
+// not a terminal and COLUMNS is not set
+static inline size_t _terminal_width() {
+#if defined(ARGPARSE_POSIX) && defined(TIOCGWINSZ)
+  struct winsize w;
+  if (isatty(STDOUT_FILENO) && ioctl(STDOUT_FILENO, TIOCGWINSZ, &w) == 0 &&
+      w.ws_col > 0) {
+    return w.ws_col;
+  }
+#endif
+  const char *columns = std::getenv("COLUMNS");
+  size_t width = 0;
+  if (!columns || _convert(StringView(columns), width) != CONVERSION_OK) {
+    return 0;
+  }
+  return width;
+}
+
+static inline const char *_c_str(const std::string &s) { return s.c_str(); }
+static inline const char *_c_str(const char *s) { return s; }
+
+// Range of indices [begin, end) packed into one atomic word so the owner can
+// take from the front while other threads steal the back half of it.
+class work_range {
+ public:
+  void assign(uint32_t begin, uint32_t end) { _range.store(_pack(begin, end)); }
+
+  bool pop(uint32_t &index) {
+    uint64_t r = _range.load();
+    while (_begin(r) < _end(r)) {
+      if (_range.compare_exchange_weak(r, _pack(_begin(r) + 1, _end(r)))) {
+        index = _begin(r);
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // moves the back half of this range into thief
+  bool steal_into(work_range &thief) {
+    uint64_t r = _range.load();
+    while (_begin(r) < _end(r)) {
+      uint32_t mid = _begin(r) + (_end(r) - _begin(r)) / 2;
+      if (_range.compare_exchange_weak(r, _pack(_begin(r), mid))) {
+        thief.assign(mid, _end(r));
+        return true;
+      }
+    }
+    return false;
+  }
+
+  uint32_t size() const {
+    uint64_t r = _range.load();
+    return _begin(r) < _end(r) ? _end(r) - _begin(r) : 0;
+  }
+
+ private:
+  static uint64_t _pack(uint32_t begin, uint32_t end) {
+    return (static_cast<uint64_t>(end) << 32) | begin;
+  }
+  static uint32_t _begin(uint64_t r) { return static_cast<uint32_t>(r); }
+  static uint32_t _end(uint64_t r) { return static_cast<uint32_t>(r >> 32); }
+
+  std::atomic<uint64_t> _range{0};
+};
+
+// unique address per type, used as a key without needing RTTI
+template <typename T>
+struct type_key {
+  static const char id;
+};
+template <typename T>
+const char type_key<T>::id = 0;
+
+namespace is_vector_impl {
+template <typename T>
+struct is_vector : std::false_type {};
+template <typename... Args>
+struct is_vector<std::vector<Args...>> : std::true_type {};
+}  // namespace is_vector_impl
+
+// type trait to utilize the implementation type traits as well as decay the
+// type
+template <typename T>
+struct is_vector {
+  static constexpr bool const value =
+      is_vector_impl::is_vector<typename std::decay<T>::type>::value;
+};
+
+// Allocates from an Arena when given one and from the heap otherwise, so
+// containers can use either without changing type
+template <typename T>
+class arena_allocator {
+ public:
+  typedef T value_type;
+  typedef std::true_type propagate_on_container_move_assignment;
+  typedef std::true_type propagate_on_container_swap;
+
+  arena_allocator(Arena *arena = nullptr) : _arena(arena) {}
+  template <typename U>
+  arena_allocator(const arena_allocator<U> &other) : _arena(other._arena) {}
+
+  T *allocate(size_t n) {
+    if (_arena) {
+      return static_cast<T *>(_arena->allocate(n * sizeof(T), alignof(T)));
+    }
+    return static_cast<T *>(::operator new(n * sizeof(T)));
+  }
+
+  void deallocate(T *p, size_t) {
+    if (!_arena) {
+      ::operator delete(p);
+    }
+  }
+
+  template <typename U>
+  bool operator==(const arena_allocator<U> &other) const {
+    return _arena == other._arena;
+  }
+  template <typename U>
+  bool operator!=(const arena_allocator<U> &other) const {
+    return _arena != other._arena;
+  }
+
+ private:
+  template <typename U>
+  friend class arena_allocator;
+  Arena *_arena;
+};
+}  // namespace detail
+
+template <size_t N>
+class StaticArgumentParser;
+
+class ArgumentParser {
+ private:
+ public:
+  class Argument;
+
+  // Values given for one argument
+  typedef std::vector<StringView, detail::arena_allocator<StringView>> Values;
+
+  // Outcome of parsing or converting. An error carries a code along with
+  // the argument and token it concerns, and its message is only put
+  // together on the first call to what(). The names and tokens the message
+  // needs are copied into the result itself, so it can outlive the parser
+  // and the command line.
+  class Result {
+   public:
+    enum Code {
+      OK,
+      // error with a message given up front
+      MESSAGE,
+      NOT_COMPILED,
+      DUPLICATE_NAME,
+      UNRECOGNIZED_OPTION,
+      MALFORMED_ARGUMENT,
+      ARGUMENT_LEFT_OPEN,
+      TOO_FEW_VALUES,
+      TOO_MANY_VALUES,
+      REQUIRED_NOT_FOUND,
+      POSITIONAL_NOT_FOUND,
+      OPTION_IN_POSITION,
+      RESPONSE_FILE_UNREADABLE,
+      RESPONSE_FILE_CYCLE,
+      CONFIG_FILE_UNREADABLE,
+      CONFIG_LINE_MALFORMED,
+      CONFIG_KEY_UNKNOWN,
+      UNKNOWN_ARGUMENT,
+      NO_VALUE,
+      INVALID_VALUE,
+      VALUE_OUT_OF_RANGE,
+      // two arguments claim the same position
+      POSITION_TAKEN,
+      // tokens fed to a result begin() did not prepare
+      NOT_BEGUN,
+      // a positional argument taking no positions, or a negative number of
+      // them other than Count::ANY
+      POSITION_COUNT_INVALID
+    };
+
+    Result() {}
+    Result(std::string err) noexcept : _code(MESSAGE), _what(err) {}
+    Result(const Result &o)
+        : _code(o._code),
+          _argument(o._argument),
+          _token(o._token),
+          _position(o._position),
+          _name_size(o._name_size),
+          _text_size(o._text_size),
+          _what(o._what),
+          _suggest(o._suggest),
+          _source(o._source) {
+      _copy_chars(o);
+    }
+    Result(Result &&o) noexcept
+        : _code(o._code),
+          _argument(o._argument),
+          _token(o._token),
+          _position(o._position),
+          _name_size(o._name_size),
+          _text_size(o._text_size),
+          _what(std::move(o._what)),
+          _suggest(o._suggest),
+          _source(std::move(o._source)) {
+      _copy_chars(o);
+    }
+    Result &operator=(const Result &o) {
+      Result copy(o);
+      return *this = std::move(copy);
+    }
+    Result &operator=(Result &&o) noexcept {
+      _code = o._code;
+      _argument = o._argument;
+      _token = o._token;
+      _position = o._position;
+      _name_size = o._name_size;
+      _text_size = o._text_size;
+      _what = std::move(o._what);
+      _suggest = o._suggest;
+      _source = std::move(o._source);
+      _copy_chars(o);
+      return *this;
+    }
+
+    // name is the name of the argument concerned and text the offending
+    // token or value. Both are copied, and cut short when they do not fit.
+    Result(Code code, int argument, int token, StringView name,
+           StringView text = StringView(), int position = 0) noexcept
+        : _code(code),
+          _argument(argument),
+          _token(token),
+          _position(position) {
+      // the name gets at most a third of the room, the text the rest
+      _name_size = static_cast<unsigned char>(
+          std::min(name.size(), sizeof(_chars) / 3));
+      _text_size = static_cast<unsigned char>(
+          std::min(text.size(), sizeof(_chars) - _name_size));
+      if (_name_size) {
+        std::memcpy(_chars, name.data(), _name_size);
+      }
+      if (_text_size) {
+        std::memcpy(_chars + _name_size, text.data(), _text_size);
+      }
+    }
+
+    operator bool() const { return _code != OK; }
+
+    friend std::ostream &operator<<(std::ostream &os, const Result &dt);
+
+    Code code() const { return _code; }
+
+    // index of the argument the error concerns, or -1
+    int argument() const { return _argument; }
+
+    // index in argv of the token the error concerns, or -1 when it concerns
+    // the command line as a whole
+    int token() const { return _token; }
+
+    // the offending token or value, which the result owns
+    StringView text() const {
+      return StringView(_chars + _name_size, _text_size);
+    }
+
+    // The expected position for position errors, the line for config file
+    // errors, and for conversion errors the index of the offending value
+    // among the argument's values
+    int position() const { return _position; }
+
+    // For an unrecognized option, the registered name closest to it by
+    // edit distance, or an empty string when none is close. Like what(), it
+    // is only worked out when asked for. An ArgumentParser's result shares
+    // the names with the parser, so it can be asked after the parser is
+    // gone; a StaticArgumentParser's reads its StaticArgument array.
+    std::string suggestion() const {
+      return _suggest ? _suggest(_source.get(), text()) : std::string();
+    }
+
+    const std::string &what() const {
+      if (_what.empty() && _code > MESSAGE) {
+        _what = _format();
+      }
+      return _what;
+    }
+
+   private:
+    std::string _format() const {
+      std::string name(_chars, _name_size);
+      std::string text = this->text().str();
+      switch (_code) {
+        case NOT_COMPILED:
+          return "Parser must be compiled before parsing into a result";
+        case DUPLICATE_NAME:
+          return "Duplicate of argument name: " + text;
+        case UNRECOGNIZED_OPTION: {
+          std::string suggestion = this->suggestion();
+          if (!suggestion.empty()) {
+            return "Unrecognized command line option '" + text +
+                   "', did you mean '" + suggestion + "'?";
+          }
+          return "Unrecognized command line option '" + text + "'";
+        }
+        case MALFORMED_ARGUMENT:
+          return "Malformed argument: " + text;
+        case ARGUMENT_LEFT_OPEN:
+          return "Current argument left open";
+        case TOO_FEW_VALUES:
+          return "Too few arguments given for " + name;
+        case TOO_MANY_VALUES:
+          return "Too many arguments given for " + name;
+        case REQUIRED_NOT_FOUND:
+          return "Required argument not found: " + name;
+        case POSITIONAL_NOT_FOUND:
+          return "Argument " + name + " expected in position " +
+                 std::to_string(_position);
+        case OPTION_IN_POSITION:
+          if (_position < 0) {
+            return "Positional argument expected at the end, but argument " +
+                   text + " found instead";
+          }
+          return "Positional argument expected in position " +
+                 std::to_string(_position) + ", but argument " + text +
+                 " found instead";
+        case RESPONSE_FILE_UNREADABLE:
+          return "Unable to read response file: " + text;
+        case RESPONSE_FILE_CYCLE:
+          return "Response file includes itself: " + text;
+        case CONFIG_FILE_UNREADABLE:
+          return "Unable to read config file: " + text;
+        case CONFIG_LINE_MALFORMED:
+          return "Malformed line " + std::to_string(_position) +
+                 " in config file: " + text;
+        case CONFIG_KEY_UNKNOWN:
+          return "Unknown key on line " + std::to_string(_position) +
+                 " of config file: " + text;
+        case UNKNOWN_ARGUMENT:
+          return "Unknown argument: " + text;
+        case NO_VALUE:
+          return "No value given for " + name;
+        case INVALID_VALUE:
+          return "Value '" + text + "' given for " + name + " is not valid";
+        case VALUE_OUT_OF_RANGE:
+          return "Value '" + text + "' given for " + name +
+                 " is out of range";
+        case POSITION_TAKEN:
+          return "Argument " + name + " takes " +
+                 (_position < 0 ? std::string("the last position")
+                                : "position " + std::to_string(_position)) +
+                 ", which " + text + " already takes";
+        case NOT_BEGUN:
+          return "Result must be prepared with begin() before tokens are "
+                 "fed to it";
+        case POSITION_COUNT_INVALID:
+          return "Argument " + name + " cannot take " + text + " positions";
+        default:
+          return std::string();
+      }
+    }
+
+    friend class ArgumentParser;
+    template <size_t N>
+    friend class StaticArgumentParser;
+
+    // Only the first _name_size + _text_size characters are copied
+    void _copy_chars(const Result &o) {
+      if (_name_size + _text_size) {
+        std::memcpy(_chars, o._chars, _name_size + _text_size);
+      }
+    }
+
+    Code _code{OK};
+    int _argument{-1};
+    int _token{-1};
+    int _position{0};
+    // the argument name followed by the text
+    unsigned char _name_size{0};
+    unsigned char _text_size{0};
+    char _chars[192];
+    mutable std::string _what{};
+    // looks up the suggestion for the text in the names _source
+    std::string (*_suggest)(const void *, StringView){nullptr};
+    std::shared_ptr<const void> _source{};
+  };
+
+  // Checked result of converting argument values to T
+  template <typename T>
+  class Conversion {
+   public:
+    Conversion(T value) : _value(std::move(value)) {}
+    Conversion(Result error) : _error(std::move(error)) {}
+
+    bool ok() const { return !_error; }
+    const T &value() const { return _value; }
+    const Result &error() const { return _error; }
+
+   private:
+    T _value{};
+    Result _error{};
+  };
+
+  // What the parses into a result cost, for results that collect it with
+  // ParseResult::collect_stats(). Counts and times add up over parses and
+  // may be cleared by assigning ParseStats(); retained_bytes is as of the
+  // end of the last parse.
+  struct ParseStats {
+    size_t parses{0};
+    size_t tokens{0};
+    // lookups of argument and subcommand names, while parsing and from
+    // exists(), get() and friends
+    size_t lookups{0};
+    size_t values{0};
+    // memory the result, and the arena it takes memory from, grew by to hold
+    // tokens and values
+    size_t allocated_bytes{0};
+    // memory held by the parser and the result between parses
+    size_t retained_bytes{0};
+    // splitting tokens into arguments and values
+    std::chrono::nanoseconds parse_time{0};
+    // checks once every token is in: positions, required arguments, counts
+    std::chrono::nanoseconds validation_time{0};
+    // converting values in get<T>() and convert<T>(), cached ones excepted
+    std::chrono::nanoseconds conversion_time{0};
+  };
+
+  // What one parse found for one argument: whether it was given and the
+  // values it was given, with typed access to them
+  class ParsedArgument {
+   public:
+    bool found() const { return _found; }
+
+    // The first name the argument was declared with
+    const std::string &name() const;
+
+    // Views of the values given for this argument. They point into the
+    // parse result's token storage, or directly into argv when zero copy
+    // parsing is enabled, and are invalidated accordingly.
+    const Values &values() const { return _values; }
+
+    ParsedArgument() {}
+    // Copies start with an empty cache and convert again on first use
+    ParsedArgument(const ParsedArgument &o)
+        : _argument(o._argument),
+          _stats(o._stats),
+          _found(o._found),
+          _from_config(o._from_config),
+          _touched(o._touched),
+          _values(o._values) {}
+    ParsedArgument(ParsedArgument &&o) noexcept
+        : _argument(o._argument),
+          _stats(o._stats),
+          _found(o._found),
+          _from_config(o._from_config),
+          _touched(o._touched),
+          _values(std::move(o._values)),
+          _cache(o._cache.exchange(nullptr)) {}
+    ParsedArgument &operator=(ParsedArgument o) {
+      _argument = o._argument;
+      _stats = o._stats;
+      _found = o._found;
+      _from_config = o._from_config;
+      _touched = o._touched;
+      _values.swap(o._values);
+      _clear_cache();
+      _cache.store(o._cache.exchange(nullptr));
+      return *this;
+    }
+    ~ParsedArgument() { _clear_cache(); }
+
+    // Converted values are cached per type, so only the first get<T>() after
+    // a parse converts the values and later calls just copy the result out
+    template <typename T>
+    T get() const {
+      return ref<T>();
+    }
+
+    // Like get, but returns the cached value itself, which stays valid until
+    // the next parse into the result. Any number of threads may read one
+    // result at once: the first to ask for a type converts and publishes it,
+    // and a cached read takes no lock.
+    template <typename T>
+    const T &ref() const {
+      const void *key = &detail::type_key<T>::id;
+      cached *head = _cache.load(std::memory_order_acquire);
+      for (cached *c = head; c; c = c->next) {
+        if (c->type == key) {
+          return static_cast<const cached_value<T> *>(c)->value;
+        }
+      }
+      cached_value<T> *t;
+      {
+        detail::stopwatch timer(_stats ? &_stats->conversion_time : nullptr);
+        t = new cached_value<T>(key, _get<T>());
+      }
+      // threads converting the same type at once each publish their own
+      // copy, and lookups settle on the newest
+      t->next = head;
+      while (!_cache.compare_exchange_weak(t->next, t,
+                                           std::memory_order_release,
+                                           std::memory_order_acquire)) {
+      }
+      return t->value;
+    }
+
+    // Like get, but reports values that are malformed or out of range for T
+    // instead of quietly returning T(). Scalars convert the first value.
+    template <typename T>
+    typename std::enable_if<detail::is_vector<T>::value, Conversion<T>>::type
+    convert() const {
+      detail::stopwatch timer(_stats ? &_stats->conversion_time : nullptr);
+      T t = T();
+      size_t index = 0;
+      detail::conversion_error e = _convert_values(t, true, index);
+      if (e != detail::CONVERSION_OK) {
+        return _conversion_error(e, index);
+      }
+      return t;
+    }
+
+    template <typename T>
+    typename std::enable_if<!detail::is_vector<T>::value, Conversion<T>>::type
+    convert() const {
+      detail::stopwatch timer(_stats ? &_stats->conversion_time : nullptr);
+      if (_values.empty()) {
+        return Result(Result::NO_VALUE, _argument->_index, -1, name());
+      }
+      T t = T();
+      detail::conversion_error e = detail::_convert(_values[0], t);
+      if (e != detail::CONVERSION_OK) {
+        return _conversion_error(e, 0);
+      }
+      return t;
+    }
+
+   private:
+    friend class ArgumentParser;
+    friend class Argument;
+    friend class ParseResult;
+
+    template <typename T>
+    typename std::enable_if<detail::is_vector<T>::value, T>::type _get()
+        const {
+      T t = T();
+      size_t index = 0;
+      _convert_values(t, false, index);
+      return t;
+    }
+
+    // Numbers are converted straight into a vector sized up front, on
+    // several threads for long lists when the argument asks for it
+    template <typename T>
+    typename std::enable_if<detail::is_bulk<typename T::value_type>::value,
+                            detail::conversion_error>::type
+    _convert_values(T &t, bool checked, size_t &index) const {
+      t.resize(_values.size());
+      return detail::_convert_all(_values, t.data(),
+                                  _argument->_conversion_threads, checked,
+                                  index);
+    }
+
+    template <typename T>
+    typename std::enable_if<!detail::is_bulk<typename T::value_type>::value,
+                            detail::conversion_error>::type
+    _convert_values(T &t, bool checked, size_t &index) const {
+      t.reserve(_values.size());
+      for (size_t i = 0; i < _values.size(); ++i) {
+        typename T::value_type vt = typename T::value_type();
+        detail::conversion_error e = detail::_convert(_values[i], vt);
+        if (e != detail::CONVERSION_OK) {
+          if (checked) {
+            index = i;
+            return e;
+          }
+          vt = typename T::value_type();
+        }
+        t.push_back(vt);
+      }
+      return detail::CONVERSION_OK;
+    }
+
+    template <typename T>
+    typename std::enable_if<!detail::is_vector<T>::value &&
+                                detail::is_number<T>::value,
+                            T>::type
+    _get() const {
+      T t = T();
+      if (_values.empty() ||
+          detail::_convert(_values[0], t) != detail::CONVERSION_OK) {
+        return T();
+      }
+      return t;
+    }
+
+    template <typename T>
+    typename std::enable_if<!detail::is_vector<T>::value &&
+                                !detail::is_number<T>::value,
+                            T>::type
+    _get() const {
+      std::istringstream in(_get<std::string>());
+      T t = T();
+      in >> t >> std::ws;
+      return t;
+    }
+
+    template <typename T>
+    static void _cache_type(const ParsedArgument &a) {
+      a.ref<T>();
+    }
+
+    Result _conversion_error(detail::conversion_error e, size_t i) const {
+      return Result(e == detail::CONVERSION_OUT_OF_RANGE
+                        ? Result::VALUE_OUT_OF_RANGE
+                        : Result::INVALID_VALUE,
+                    _argument->_index, -1, name(), _values[i],
+                    static_cast<int>(i));
+    }
+
+    void _reset(const Argument *argument) {
+      _argument = argument;
+      _found = false;
+      _from_config = false;
+      _touched = false;
+      _values.clear();
+      _clear_cache();
+    }
+
+    // Only while no other thread reads the result, between parses
+    void _clear_cache() const {
+      cached *c = _cache.exchange(nullptr, std::memory_order_relaxed);
+      while (c) {
+        cached *next = c->next;
+        delete c;
+        c = next;
+      }
+    }
+
+    const Argument *_argument{nullptr};
+    ParseStats *_stats{nullptr};
+    bool _found{false};
+    bool _from_config{false};
+    // changed by the current parse, see ParseResult::_touch
+    bool _touched{false};
+    Values _values{};
+
+    // Converted values, one list node per type, pushed at the head and
+    // never changed once published
+    struct cached {
+      explicit cached(const void *t) : type(t) {}
+      cached(const cached &) = delete;
+      cached &operator=(const cached &) = delete;
+      virtual ~cached() {}
+      const void *type;
+      cached *next{nullptr};
+    };
+    template <typename T>
+    struct cached_value : cached {
+      cached_value(const void *t, T &&v) : cached(t), value(std::move(v)) {}
+      T value;
+    };
+    mutable std::atomic<cached *> _cache{nullptr};
+  };
+
+  // The outcome of parsing one command line: which arguments were found and
+  // their values. Parsing into a ParseResult never modifies the compiled
+  // ArgumentParser, and binds and actions do not run for it, so any number
+  // of threads can each parse into their own result against one shared
+  // parser, which must outlive the results.
+  class ParseResult {
+   public:
+    ParseResult() {}
+
+    // Takes the values and tokens of every parse from arena, which is
+    // released at the start of each parse and on reset(), so it must not be
+    // shared with anything else. A result using an arena should not be
+    // copied.
+    explicit ParseResult(Arena &arena) : _arena(&arena) {}
+
+    ParseResult(const ParseResult &) = default;
+    ParseResult(ParseResult &&) = default;
+    ParseResult &operator=(const ParseResult &) = default;
+    ParseResult &operator=(ParseResult &&) = default;
+
+    bool exists(StringView name) const {
+      const ParsedArgument *a = _find(name);
+      return a && a->_found;
+    }
+
+    // Name of the subcommand given on the command line, empty if none was
+    StringView subcommand() const {
+      return _subcommand >= 0 ? _parser->_subcommand_name(_subcommand)
+                              : StringView();
+    }
+
+    // What the subcommand's parser made of the tokens after its name, or
+    // nullptr when no subcommand was given
+    const ParseResult *subcommand_result() const {
+      return _subcommand >= 0 ? _subcommand_result.get() : nullptr;
+    }
+
+    const Values &values(StringView name) const {
+      static const Values none;
+      const ParsedArgument *a = _find(name);
+      return a ? a->_values : none;
+    }
+
+    template <typename T>
+    T get(StringView name) const {
+      const ParsedArgument *a = _find(name);
+      return a ? a->get<T>() : T();
+    }
+
+    template <typename T>
+    const T &ref(StringView name) const {
+      static const T none = T();
+      const ParsedArgument *a = _find(name);
+      return a ? a->ref<T>() : none;
+    }
+
+    template <typename T>
+    Conversion<T> convert(StringView name) const {
+      const ParsedArgument *a = _find(name);
+      if (a) {
+        return a->convert<T>();
+      }
+      return Result(Result::UNKNOWN_ARGUMENT, -1, -1, StringView(), name);
+    }
+
+    // Counts and times the parses into this result and the conversions of
+    // its values in stats, which must outlive the result or be replaced.
+    // With nullptr, the default, nothing is counted and the clock is never
+    // read.
+    void collect_stats(ParseStats *stats) {
+      _stats = stats;
+      for (auto &a : _arguments) {
+        a._stats = stats;
+      }
+    }
+
+    // Clears the values while keeping the memory that holds them. Results
+    // are also reset at the start of every parse.
+    void reset() {
+      _prepared = false;
+      _current = -1;
+      _index = 0;
+      _pending_index = 0;
+      _token_index = -1;
+      _subcommand = -1;
+      _files.clear();
+      _block = 0;
+      _block_used = 0;
+      for (auto &b : _blocks) {
+        if (b.data.use_count() > 1) {
+          // a copy of this result still refers to the tokens
+          _blocks.clear();
+          break;
+        }
+      }
+      // only the arguments the last parse changed need clearing
+      for (size_t i : _touched) {
+        ParsedArgument &a = _arguments[i];
+        if (_arena) {
+          // the memory behind the values goes back with the arena
+          a._values = Values(_arena);
+        }
+        a._reset(a._argument);
+      }
+      _touched.clear();
+      if (_arena) {
+        _arena->release();
+      }
+    }
+
+   private:
+    friend class ArgumentParser;
+
+    // The argument at index, recorded as changed by this parse so reset()
+    // has to clear it. Arguments the parse never touches keep their empty
+    // state, and values cached from it stay valid.
+    ParsedArgument &_touch(int index) {
+      ParsedArgument &a = _arguments[static_cast<size_t>(index)];
+      if (!a._touched) {
+        a._touched = true;
+        a._clear_cache();
+        _touched.push_back(static_cast<size_t>(index));
+      }
+      return a;
+    }
+
+    const ParsedArgument *_find(StringView name) const {
+      if (_stats) {
+        ++_stats->lookups;
+      }
+      return _parser ? _parser->_find(*this, name) : nullptr;
+    }
+
+    // Memory held for tokens and values, the heap blocks of the arena
+    // included when the result takes them from one
+    size_t _retained_bytes() const {
+      size_t n = _arguments.capacity() * sizeof(ParsedArgument) +
+                 _touched.capacity() * sizeof(size_t) + _storage_size +
+                 _blocks.capacity() * sizeof(block);
+      for (auto &b : _blocks) {
+        n += b.size;
+      }
+      if (_arena) {
+        // values live in the arena too
+        return n + _arena->reserved_bytes();
+      }
+      for (auto &a : _arguments) {
+        n += a._values.capacity() * sizeof(StringView);
+      }
+      return n;
+    }
+
+    // Copies a token fed to the parser into blocks owned by the result,
+    // starting a new block whenever the current one is full
+    StringView _keep(StringView token) {
+      if (_arena) {
+        char *data = _allocate(token.size());
+        std::memcpy(data, token.data(), token.size());
+        return StringView(data, token.size());
+      }
+      while (_block < _blocks.size() &&
+             _blocks[_block].size - _block_used < token.size()) {
+        ++_block;
+        _block_used = 0;
+      }
+      if (_block == _blocks.size()) {
+        size_t size = std::max<size_t>(token.size(), 4096);
+        std::shared_ptr<char> data(new char[size],
+                                   std::default_delete<char[]>());
+        _blocks.push_back({data, size});
+      }
+      char *data = _blocks[_block].data.get() + _block_used;
+      std::memcpy(data, token.data(), token.size());
+      _block_used += token.size();
+      return StringView(data, token.size());
+    }
+
+    char *_allocate(size_t size) {
+      return static_cast<char *>(_arena->allocate(size, 1));
+    }
+
+    Arena *_arena{nullptr};
+    const ArgumentParser *_parser{nullptr};
+    // arguments of the parser the result was last prepared for
+    const Argument *_schema{nullptr};
+    std::vector<ParsedArgument> _arguments{};
+    // indexes of the arguments changed since the last reset
+    std::vector<size_t> _touched{};
+    int _current{-1};
+    std::shared_ptr<char> _storage{};
+    size_t _storage_size{0};
+    // tokens handed to the parser so far, and the last of them, which is
+    // held back until it is known whether it ends the command line
+    int _index{0};
+    StringView _pending{};
+    int _pending_index{0};
+    // index of the token being parsed
+    int _token_index{-1};
+    // subcommand the tokens are handed on to, and the result they go into
+    int _subcommand{-1};
+    std::shared_ptr<ParseResult> _subcommand_result{};
+    // response files the values may refer to
+    std::vector<std::shared_ptr<detail::mapped_file>> _files{};
+    // storage for tokens fed one at a time
+    struct block {
+      std::shared_ptr<char> data;
+      size_t size;
+    };
+    std::vector<block> _blocks{};
+    size_t _block{0};
+    size_t _block_used{0};
+    std::function<void(const ParsedArgument &)> _on_argument{};
+    // set on the parser's own result, the only one binds and actions run for
+    bool _run_actions{false};
+    // prepared by _parser for a parse that has not finished yet
+    bool _prepared{false};
+    ParseStats *_stats{nullptr};
+    // _retained_bytes() when the parse began
+    size_t _retained_at_begin{0};
+  };
+
+  class Argument {
+   public:
+    enum Position : int { LAST = -1, DONT_CARE = -2 };
+    enum Count : int { ANY = -1 };
+
+    Argument(const Argument &) = default;
+    Argument(Argument &&) = default;
+    Argument &operator=(const Argument &) = default;
+    Argument &operator=(Argument &&) = default;
+
+    Argument &name(const std::string &name) {
+      _names.push_back(name);
+      return *this;
+    }
+
+    Argument &names(std::vector<std::string> names) {
+      _names.insert(_names.end(), names.begin(), names.end());
+      return *this;
+    }
+
+    Argument &description(const std::string &description) {
+      _desc = description;
+      return *this;
+    }
+
+    Argument &required(bool req) {
+      _required = req;
+      return *this;
+    }
+
+    Argument &position(int position) {
+      if (position != Position::LAST) {
+        // position + 1 because technically argument zero is the name of the
+        // executable
+        _position = position + 1;
+      } else {
+        _position = position;
+      }
+      return *this;
+    }
+
+    // Takes the count tokens starting at position first, or with Count::ANY
+    // every token from first on, options included. Any other count below one
+    // fails compile() with POSITION_COUNT_INVALID, and a parse that fills
+    // only part of the range fails with POSITIONAL_NOT_FOUND.
+    Argument &positions(int first, int count) {
+      position(first);
+      _positions = count;
+      return *this;
+    }
+
+    Argument &count(int count) {
+      _count = count;
+      return *this;
+    }
+
+    // Converts lists of numbers on up to threads threads at once, which
+    // pays off from tens of thousands of values. Shorter lists are always
+    // converted on the calling thread.
+    Argument &conversion_threads(unsigned threads) {
+      _conversion_threads = threads;
+      return *this;
+    }
+
+    // Declares the type the values will be read as, so they are converted
+    // once when parsing finishes instead of on the first call to get<T>()
+    template <typename T>
+    Argument &type() {
+      _eager.push_back(&ParsedArgument::_cache_type<T>);
+      return *this;
+    }
+
+    // Converts the values into target, as convert<T>() would, as soon as
+    // the argument is complete during parsing, so they need not be looked up
+    // afterwards. Values that do not convert fail the parse and leave target
+    // as it was. target must outlive every parse.
+    //
+    // Like actions, binds only run for the parser's own parse(argc, argv),
+    // never when parsing into a ParseResult, so those parses can still run
+    // on several threads at once.
+    template <typename T>
+    Argument &bind(T &target) {
+      T *t = &target;
+      _actions.push_back([t](const ParsedArgument &a) {
+        if (a._values.empty()) {
+          *t = T();
+          return Result();
+        }
+        Conversion<T> c = a.convert<T>();
+        if (c.ok()) {
+          *t = c.value();
+        }
+        return c.error();
+      });
+      return *this;
+    }
+
+    // A bound flag is set when the argument is given without a value
+    Argument &bind(bool &target) {
+      bool *t = &target;
+      _actions.push_back([t](const ParsedArgument &a) {
+        if (a._values.empty()) {
+          *t = true;
+          return Result();
+        }
+        Conversion<bool> c = a.convert<bool>();
+        if (c.ok()) {
+          *t = c.value();
+        }
+        return c.error();
+      });
+      return *this;
+    }
+
+    // Calls action with the argument as soon as it is complete during
+    // parse(argc, argv), on the thread doing the parsing. Parses into a
+    // ParseResult skip actions, see bind().
+    Argument &action(std::function<void(const ParsedArgument &)> action) {
+      _actions.push_back([action](const ParsedArgument &a) {
+        action(a);
+        return Result();
+      });
+      return *this;
+    }
+
+    // Results of the parser's own parse(argc, argv) for this argument
+    bool found() const { return _parsed() && _parsed()->found(); }
+
+    const Values &values() const {
+      static const Values none;
+      return _parsed() ? _parsed()->values() : none;
+    }
+
+    template <typename T>
+    T get() const {
+      return _parsed() ? _parsed()->get<T>() : T();
+    }
+
+    template <typename T>
+    Conversion<T> convert() const {
+      if (_parsed()) {
+        return _parsed()->convert<T>();
+      }
+      return Result(Result::NO_VALUE, _index, -1, _names[0]);
+    }
+
+   private:
+    Argument(const std::string &name, const std::string &desc,
+             bool required = false)
+        : _desc(desc), _required(required) {
+      _names.push_back(name);
+    }
+
+    Argument() {}
+
+    const ParsedArgument *_parsed() const {
+      if (_result && static_cast<size_t>(_index) < _result->_arguments.size()) {
+        return &_result->_arguments[static_cast<size_t>(_index)];
+      }
+      return nullptr;
+    }
+
+    friend class ArgumentParser;
+    friend class ParsedArgument;
+    int _position{Position::DONT_CARE};
+    int _positions{1};
+    int _count{Count::ANY};
+    std::vector<std::string> _names{};
+    std::string _desc{};
+    bool _required{false};
+    int _index{-1};
+    const ParseResult *_result{nullptr};
+    std::vector<void (*)(const ParsedArgument &)> _eager{};
+    std::vector<std::function<Result(const ParsedArgument &)>> _actions{};
+    unsigned _conversion_threads{1};
+  };
+
+  ArgumentParser(const std::string &bin, const std::string &desc)
+      : _bin(bin), _desc(desc), _result(std::make_shared<ParseResult>()) {}
+
+  // A copy takes the declared arguments, subcommands and settings and is
+  // compiled afresh, as the tables compile() builds point into the parser
+  // they were built for. It starts out with no parse of its own.
+  ArgumentParser(const ArgumentParser &o)
+      : _help_enabled(o._help_enabled),
+        _zero_copy(o._zero_copy),
+        _response_files(o._response_files),
+        _free_values(o._free_values),
+        _config_path(o._config_path),
+        _config_required(o._config_required),
+        _bin(o._bin),
+        _desc(o._desc),
+        _arguments(o._arguments),
+        _subcommands(o._subcommands),
+        _result(std::make_shared<ParseResult>()) {
+    for (auto &a : _arguments) {
+      a._result = _result.get();
+    }
+  }
+  ArgumentParser(ArgumentParser &&) = default;
+  ArgumentParser &operator=(const ArgumentParser &o) {
+    if (this != &o) {
+      *this = ArgumentParser(o);
+    }
+    return *this;
+  }
+  ArgumentParser &operator=(ArgumentParser &&) = default;
+
+  Argument &add_argument() {
+    _arguments.push_back({});
+    _arguments.back()._index = static_cast<int>(_arguments.size()) - 1;
+    _compiled = false;
+    return _arguments.back();
+  }
+
+  Argument &add_argument(const std::string &name, const std::string &long_name,
+                         const std::string &desc, const bool required = false) {
+    _arguments.push_back(Argument(name, desc, required));
+    _arguments.back()._names.push_back(long_name);
+    _arguments.back()._index = static_cast<int>(_arguments.size()) - 1;
+    _compiled = false;
+    return _arguments.back();
+  }
+
+  Argument &add_argument(const std::string &name, const std::string &desc,
+                         const bool required = false) {
+    _arguments.push_back(Argument(name, desc, required));
+    _arguments.back()._index = static_cast<int>(_arguments.size()) - 1;
+    _compiled = false;
+    return _arguments.back();
+  }
+
+  // Registers a subcommand, chosen by a token equal to name that is not a
+  // value an open option still needs. The tokens after it are parsed by a
+  // parser of its own, which factory fills with arguments. That parser is
+  // only built the first time the subcommand is chosen, so a tool with many
+  // subcommands pays for the one it runs. Its results are read through
+  // subcommand_result().
+  void add_subcommand(const std::string &name, const std::string &desc,
+                      std::function<void(ArgumentParser &)> factory) {
+    std::shared_ptr<command> c = std::make_shared<command>();
+    c->name = name;
+    c->desc = desc;
+    c->factory = std::move(factory);
+    _subcommands.push_back(c);
+    _compiled = false;
+  }
+
+  void print_help(size_t count = 0, size_t page = 0) {
+    print_help(std::cout, count, page, detail::_terminal_width());
+  }
+
+  // Writes the help page to os in one write, wrapping descriptions to width
+  // columns unless width is 0
+  void print_help(std::ostream &os, size_t count = 0, size_t page = 0,
+                  size_t width = 0) {
+    const std::string &text = help(count, page, width);
+    os.write(text.data(), static_cast<std::streamsize>(text.size()));
+    os.flush();
+  }
+
+  // Help page listing count arguments starting from page * count, or all of
+  // them when count is 0. The text is kept until arguments are added, so
+  // printing the same page again only copies it out. Arguments that do not
+  // compile give the compile error instead.
+  const std::string &help(size_t count = 0, size_t page = 0,
+                          size_t width = 0) {
+    if (!_compiled) {
+      Result err = compile();
+      if (err) {
+        _help.valid = false;
+        _help.text = err.what() + "\n";
+        return _help.text;
+      }
+    }
+    if (_help.valid && _help.count == count && _help.page == page &&
+        _help.width == width) {
+      return _help.text;
+    }
+    _help.valid = true;
+    _help.count = count;
+    _help.page = page;
+    _help.width = width;
+    std::string &out = _help.text;
+    out.clear();
+    if (page * count > _arguments.size()) {
+      return out;
+    }
+    if (page == 0) {
+      out += "Usage: ";
+      out += _bin;
+      if (_positional.empty() && _greedy < 0 && _last < 0) {
+        out += " [options...]\n";
+      } else {
+        int previous = -1;
+        for (size_t p = 0; p < _positional.size(); ++p) {
+          int i = _positional[p];
+          if (i < 0 && p > 0) {
+            out += " [" + std::to_string(p) + "]";
+          } else if (i >= 0 && i != previous) {
+            _usage_name(out, i, "]");
+          }
+          previous = i;
+        }
+        if (_greedy >= 0) {
+          _usage_name(out, _greedy, "...]");
+        }
+        out += " [options...]";
+        if (_last >= 0) {
+          _usage_name(out, _last, "]");
+        }
+        out += "\n";
+      }
+      out += "Options:\n";
+    }
+    bool full = count == 0;
+    if (count == 0) {
+      page = 0;
+      count = _arguments.size();
+    }
+    // descriptions start in one column for every argument, wide enough for
+    // all but unusually long names, which get their description on the
+    // next line instead
+    const size_t indent = 4 + _help_column;
+    for (size_t i = page * count;
+         i < std::min<size_t>(page * count + count, _arguments.size()); i++) {
+      Argument &a = _arguments[i];
+      size_t line = out.size();
+      out += "    ";
+      for (size_t n = 0; n < a._names.size(); ++n) {
+        if (n > 0) {
+          out += ", ";
+        }
+        out += a._names[n];
+      }
+      if (out.size() - line >= indent) {
+        out += "\n";
+        line = out.size();
+      }
+      out.append(indent - (out.size() - line), ' ');
+      _wrap(out, a._desc, indent, width);
+      if (a._required) {
+        if (a._desc.size() < 23) {
+          out.append(23 - a._desc.size(), ' ');
+        }
+        out += " (Required)";
+      }
+      out += "\n";
+    }
+    if (full && !_subcommands.empty()) {
+      out += "Commands:\n";
+      for (auto &c : _subcommands) {
+        size_t line = out.size();
+        out += "    ";
+        out += c->name;
+        if (out.size() - line >= indent) {
+          out += "\n";
+          line = out.size();
+        }
+        out.append(indent - (out.size() - line), ' ');
+        _wrap(out, c->desc, indent, width);
+        out += "\n";
+      }
+    }
+    return out;
+  }
+
+  // Freezes the arguments added so far into the lookup tables used by
+  // parse(). parse(argc, argv) does this on its own the first time and after
+  // arguments are added; parsing into a ParseResult requires it. Arguments
+  // changed through a reference kept from add_argument() need another call
+  // to compile().
+  Result compile() {
+    _compiled = false;
+    _name_map.clear();
+    _subcommand_map.clear();
+    _completion_names.clear();
+    _short.fill(-1);
+    _positional.clear();
+    _expected.clear();
+    _typed.clear();
+    _greedy = -1;
+    _greedy_position = 0;
+    _last = -1;
+    _help_index = -1;
+    _help.valid = false;
+    _help_column = 23;
+    std::shared_ptr<detail::suggestion_index> suggestions =
+        std::make_shared<detail::suggestion_index>();
+    for (auto &a : _arguments) {
+      size_t names = 2 * (a._names.size() - 1);
+      for (auto &n : a._names) {
+        names += n.size();
+      }
+      if (names < 40) {
+        _help_column = std::max(_help_column, names + 1);
+      }
+      for (auto &n : a._names) {
+        StringView name = detail::_strip_dashes(n);
+        if (!_name_map.insert(name, a._index)) {
+          return Result(Result::DUPLICATE_NAME, a._index, -1, a._names[0], n);
+        }
+        if (!n.empty()) {
+          _completion_names.push_back({n, &a._desc});
+          suggestions->add(n);
+        }
+        if (name.size() == 1) {
+          _short[static_cast<unsigned char>(name[0])] = a._index;
+        }
+      }
+      if (a._position >= 0 &&
+          (a._positions == 0 || a._positions < Argument::Count::ANY)) {
+        return _error(Result::POSITION_COUNT_INVALID, -1, a._index,
+                      std::to_string(a._positions));
+      }
+      if (a._position == Argument::Position::LAST) {
+        if (_last >= 0) {
+          return _position_taken(a._index, _last, a._position);
+        }
+        _last = a._index;
+      } else if (a._position >= 0 && a._positions < 0) {
+        if (_greedy >= 0) {
+          return _position_taken(a._index, _greedy,
+                                 std::max(a._position, _greedy_position));
+        }
+        _greedy = a._index;
+        _greedy_position = a._position;
+      } else if (a._position >= 0) {
+        size_t end = static_cast<size_t>(a._position + a._positions);
+        if (_positional.size() < end) {
+          _positional.resize(end, -1);
+        }
+        for (size_t p = static_cast<size_t>(a._position); p < end; ++p) {
+          if (_positional[p] >= 0) {
+            return _position_taken(a._index, _positional[p],
+                                   static_cast<int>(p));
+          }
+          _positional[p] = a._index;
+        }
+      }
+      if (a._required || a._position >= 0) {
+        _expected.push_back(a._index);
+      }
+      if (!a._eager.empty()) {
+        _typed.push_back(a._index);
+      }
+      a._result = _result.get();
+    }
+    for (size_t p = static_cast<size_t>(_greedy_position);
+         _greedy >= 0 && p < _positional.size(); ++p) {
+      if (_positional[p] >= 0) {
+        return _position_taken(std::max(_greedy, _positional[p]),
+                               std::min(_greedy, _positional[p]),
+                               static_cast<int>(p));
+      }
+    }
+    for (size_t i = 0; i < _subcommands.size(); ++i) {
+      if (!_subcommand_map.insert(_subcommands[i]->name, static_cast<int>(i))) {
+        return Result(Result::DUPLICATE_NAME, -1, -1, StringView(),
+                      _subcommands[i]->name);
+      }
+      if (!_subcommands[i]->name.empty()) {
+        _completion_names.push_back(
+            {_subcommands[i]->name, &_subcommands[i]->desc});
+      }
+    }
+    std::sort(_completion_names.begin(), _completion_names.end(),
+              [](const completion_name &a, const completion_name &b) {
+                return a.name < b.name;
+              });
+    if (_help_enabled) {
+      _help_index = _name_map.find("help");
+    }
+    suggestions->build();
+    // results suggesting names share the index, so it outlives the parser
+    _suggestions = suggestions;
+    // read by the first parse that needs it, see _read_config
+    _config = std::make_shared<config_state>();
+    _compiled = true;
+    return Result();
+  }
+
+  // Clears the results of the last parse(argc, argv) while keeping the
+  // compiled tables and the memory used for values.
+  void reset() { _result->reset(); }
+
+  // Parses the command line into the parser's own result, read back with
+  // exists(), get() and friends. Each call starts from a clean state, so one
+  // parser can parse many command lines.
+  Result parse(int argc, const char *argv[]) {
+    if (!_compiled) {
+      Result err = compile();
+      if (err) {
+        return err;
+      }
+    }
+    _result->_run_actions = true;
+    return parse(argc, argv, *_result);
+  }
+
+  // Parses the command line into result without modifying the parser, which
+  // must have been compiled. Values are copied into a block of storage owned
+  // by the result, unless zero copy parsing is enabled, in which case they
+  // refer to argv directly and argv must outlive every use of the values.
+  Result parse(int argc, const char *argv[], ParseResult &result) const {
+    if (!_compiled) {
+      return Result(Result::NOT_COMPILED, -1, -1, StringView());
+    }
+    _prepare(result);
+    Result err;
+    if (argc > 1) {
+      // copy every token into one block instead of one string per token,
+      // reusing the block from the last parse when nothing else refers to it
+      char *storage = nullptr;
+      if (!_zero_copy) {
+        size_t total = 0;
+        for (int argv_index = 1; argv_index < argc; ++argv_index) {
+          total += std::strlen(argv[argv_index]);
+        }
+        if (result._arena) {
+          storage = result._allocate(total);
+        } else {
+          if (total >= result._storage_size ||
+              result._storage.use_count() > 1) {
+            result._storage_size = std::max(total + 1, result._storage_size);
+            result._storage.reset(new char[result._storage_size],
+                                  std::default_delete<char[]>());
+          }
+          storage = result._storage.get();
+        }
+      }
+
+      // parse
+      detail::stopwatch timer(result._stats ? &result._stats->parse_time
+                                            : nullptr);
+      StringView current_arg;
+      std::vector<const detail::mapped_file *> open_files;
+      for (int argv_index = 1; argv_index < argc; ++argv_index) {
+        current_arg = StringView(argv[argv_index]);
+        if (_response_files && current_arg.size() > 1 &&
+            current_arg[0] == '@') {
+          err = _expand(result, current_arg.substr(1), open_files);
+        } else {
+          if (storage) {
+            std::memcpy(storage, current_arg.data(), current_arg.size());
+            current_arg = StringView(storage, current_arg.size());
+            storage += current_arg.size();
+          }
+          err = _push(result, current_arg);
+        }
+        if (err) {
+          return err;
+        }
+      }
+    }
+    return _finish(result);
+  }
+
+  // Starts parsing a command line that arrives one token at a time, such as
+  // one read from a pipe or socket, into result. Tokens are handed over with
+  // feed(), program name excluded, and finish() runs the checks parse() runs
+  // once all tokens are in. on_argument is called as soon as each argument
+  // is complete: when an option has all the values its count asks for, when
+  // the next option starts, or at the latest from finish(). The parser must
+  // have been compiled. feed() and finish() return NOT_BEGUN for a result
+  // that has not been begun, or was reset or finished since.
+  Result begin(ParseResult &result,
+               std::function<void(const ParsedArgument &)> on_argument =
+                   nullptr) const {
+    if (!_compiled) {
+      return Result(Result::NOT_COMPILED, -1, -1, StringView());
+    }
+    _prepare(result);
+    result._on_argument = std::move(on_argument);
+    return Result();
+  }
+
+  // Parses the next token. The token is copied into storage owned by the
+  // result unless zero copy parsing is enabled, in which case it must
+  // outlive every use of the values.
+  Result feed(ParseResult &result, StringView token) const {
+    if (!_begun(result)) {
+      return Result(Result::NOT_BEGUN, -1, -1, StringView());
+    }
+    detail::stopwatch timer(result._stats ? &result._stats->parse_time
+                                          : nullptr);
+    if (_response_files && token.size() > 1 && token[0] == '@') {
+      std::vector<const detail::mapped_file *> open_files;
+      return _expand(result, token.substr(1), open_files);
+    }
+    if (!_zero_copy) {
+      token = result._keep(token);
+    }
+    return _push(result, token);
+  }
+
+  Result finish(ParseResult &result) const {
+    if (!_begun(result)) {
+      return Result(Result::NOT_BEGUN, -1, -1, StringView());
+    }
+    return _finish(result);
+  }
+
+  // Parses a batch of command lines on a pool of threads. lines is a random
+  // access container whose elements are containers of std::string or
+  // const char * holding a full argv, program name included. Lines are
+  // split evenly between the threads and threads that run out steal half of
+  // the remaining lines of the busiest one.
+  // results is resized to match lines and the returned errors are in the
+  // same order. The parser must be compiled. threads defaults to the
+  // hardware concurrency.
+  template <typename Lines>
+  std::vector<Result> parse_batch(const Lines &lines,
+                                  std::vector<ParseResult> &results,
+                                  unsigned threads = 0) const {
+    std::vector<Result> errors(lines.size());
+    results.resize(lines.size());
+    if (threads == 0) {
+      threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    // work ranges hold 32 bit indices, so very large batches go in slices
+    const size_t slice = std::numeric_limits<uint32_t>::max();
+    for (size_t first = 0; first < lines.size(); first += slice) {
+      uint32_t count =
+          static_cast<uint32_t>(std::min(lines.size() - first, slice));
+      uint32_t workers = std::min<uint32_t>(threads, count);
+      std::vector<detail::work_range> ranges(workers);
+      for (uint32_t w = 0; w < workers; ++w) {
+        uint64_t n = count;
+        ranges[w].assign(static_cast<uint32_t>(n * w / workers),
+                         static_cast<uint32_t>(n * (w + 1) / workers));
+      }
+      auto work = [&](uint32_t w) {
+        std::vector<const char *> argv;
+        uint32_t i;
+        for (;;) {
+          while (ranges[w].pop(i)) {
+            size_t line = first + i;
+            argv.clear();
+            for (auto &token : lines[line]) {
+              argv.push_back(detail::_c_str(token));
+            }
+            errors[line] = parse(static_cast<int>(argv.size()), argv.data(),
+                                 results[line]);
+          }
+          // steal from whichever worker has the most lines left
+          uint32_t victim = w;
+          uint32_t most = 0;
+          for (uint32_t v = 0; v < workers; ++v) {
+            uint32_t left = ranges[v].size();
+            if (left > most) {
+              victim = v;
+              most = left;
+            }
+          }
+          if (most == 0) {
+            return;
+          }
+          ranges[victim].steal_into(ranges[w]);
+        }
+      };
+      std::vector<std::thread> pool;
+      for (uint32_t w = 1; w < workers; ++w) {
+        pool.emplace_back(work, w);
+      }
+      work(0);
+      for (auto &t : pool) {
+        t.join();
+      }
+    }
+    return errors;
+  }
+
+  void enable_help() {
+    add_argument("-h", "--help", "Shows this page", false);
+    _help_enabled = true;
+  }
+
+  // Expands tokens of the form @file into the tokens read from file, which
+  // are separated by whitespace and may be quoted with ' or " or escaped
+  // with \. Response files may name further response files. The file is
+  // mapped into memory and values refer to it directly, so it stays mapped
+  // for as long as the result that read it.
+  void enable_response_files() { _response_files = true; }
+
+  // Takes values from the file at path for the arguments not given on the
+  // command line. Each line is name = value, the name being an argument name
+  // without dashes and the value split into values like a response file. A
+  // flag is set by its name alone or by a true or false value. A [section]
+  // line prefixes the names after it with "section.", and lines starting
+  // with # or ; are comments. A missing file is only an error when required
+  // is set; errors in the file are reported by every parse.
+  // The file is read once, by the first parse after the parser is next
+  // compiled, and every later parse reuses what was read; help() and
+  // complete() never read it. Call config_file() again to read it afresh.
+  void config_file(const std::string &path, bool required = false) {
+    _config_path = path;
+    _config_required = required;
+    _compiled = false;
+  }
+
+  // Stores argument values as views into argv rather than copying them. The
+  // caller must keep argv alive for as long as values are read.
+  void enable_zero_copy() { _zero_copy = true; }
+
+  // Lets through values that neither an option nor a positional argument
+  // takes, such as the tokens between declared positions, and ignores them.
+  // Otherwise such a value fails the parse with UNKNOWN_ARGUMENT.
+  void enable_free_values() { _free_values = true; }
+
+  // Answers a completion query made by the scripts from completion_script(),
+  // which run the program as "prog __complete word...", passing the words
+  // typed so far up to the one being completed. The names starting with the
+  // last word are written to os one per line, followed by a tab and their
+  // description, and true is returned so the caller can exit right away.
+  // Options are only offered once the word starts with -, subcommands
+  // otherwise, and the words after a subcommand are completed by its
+  // parser. Returns false, writing nothing, when argv is not a query.
+  // When the parser does not compile, nothing is offered and the error is
+  // written to std::cerr, which the scripts discard.
+  bool complete(int argc, const char *argv[], std::ostream &os = std::cout) {
+    if (argc < 2 || StringView(argv[1]) != "__complete") {
+      return false;
+    }
+    if (!_compiled) {
+      Result err = compile();
+      if (err) {
+        std::cerr << err << std::endl;
+        return true;
+      }
+    }
+    _completions(argv + 2, argc - 2, os);
+    os.flush();
+    return true;
+  }
+
+  // Completion script for shell, one of bash, zsh or fish, that asks the
+  // program for completions through complete(). Empty for other shells.
+  std::string completion_script(StringView shell) const {
+    std::string function = "_";
+    for (char c : _bin) {
+      function += std::isalnum(static_cast<unsigned char>(c)) ? c : '_';
+    }
+    function += "_complete";
+    std::string out;
+    if (shell == "bash") {
+      out += function + "() {\n";
+      out += "  local IFS=$'\\n'\n";
+      out += "  COMPREPLY=($(" + _bin +
+             " __complete \"${COMP_WORDS[@]:1:COMP_CWORD}\" 2>/dev/null))\n";
+      out += "  COMPREPLY=(\"${COMPREPLY[@]%%$'\\t'*}\")\n";
+      out += "}\n";
+      out += "complete -o default -F " + function + " " + _bin + "\n";
+    } else if (shell == "zsh") {
+      out += "#compdef " + _bin + "\n";
+      out += function + "() {\n";
+      out += "  local -a names\n";
+      out += "  names=(\"${(@f)$(" + _bin +
+             " __complete \"${(@)words[2,CURRENT]}\" 2>/dev/null)}\")\n";
+      out += "  names=(\"${(@)names//:/\\\\:}\")\n";
+      out += "  names=(\"${(@)names//$'\\t'/:}\")\n";
+      out += "  if [[ -n ${names[1]} ]]; then\n";
+      out += "    _describe 'values' names\n";
+      out += "  else\n";
+      out += "    _files\n";
+      out += "  fi\n";
+      out += "}\n";
+      out += "compdef " + function + " " + _bin + "\n";
+    } else if (shell == "fish") {
+      out += "function " + function + "\n";
+      // an empty current word must still be passed on as an argument
+      out += "  set -l cur (commandline -ct)\n";
+      out += "  " + _bin +
+             " __complete (commandline -opc)[2..-1] \"$cur\" 2>/dev/null\n";
+      out += "end\n";
+      out += "complete -c " + _bin + " -a '(" + function + ")'\n";
+    }
+    return out;
+  }
+
+  // Results of the last parse(argc, argv)
+  const ParseResult &result() const { return *_result; }
+
+  // Collects statistics on parse(argc, argv), see
+  // ParseResult::collect_stats()
+  void collect_stats(ParseStats *stats) { _result->collect_stats(stats); }
+
+  bool exists(StringView name) const { return _result->exists(name); }
+
+  StringView subcommand() const { return _result->subcommand(); }
+
+  const ParseResult *subcommand_result() const {
+    return _result->subcommand_result();
+  }
+
+  const Values &values(StringView name) const {
+    return _result->values(name);
+  }
+
+  template <typename T>
+  T get(StringView name) const {
+    return _result->get<T>(name);
+  }
+
+  template <typename T>
+  const T &ref(StringView name) const {
+    return _result->ref<T>(name);
+  }
+
+  template <typename T>
+  Conversion<T> convert(StringView name) const {
+    return _result->convert<T>(name);
+  }
+
+ private:
+  // what a parse read from the config file: for each key line the argument
+  // and its values, which are stored as offsets into text
+  struct config_line {
+    int argument;
+    size_t first;
+    size_t count;
+    // false for a flag the file turns off
+    bool set;
+  };
+  struct config_value {
+    size_t offset;
+    size_t size;
+  };
+  struct config_state {
+    std::once_flag loaded{};
+    std::vector<config_line> lines{};
+    std::vector<config_value> values{};
+    std::string text{};
+    Result error{};
+
+    StringView value(size_t i) const {
+      return StringView(text.data() + values[i].offset, values[i].size);
+    }
+    size_t retained_bytes() const {
+      return sizeof(*this) + lines.capacity() * sizeof(config_line) +
+             values.capacity() * sizeof(config_value) + text.capacity();
+    }
+  };
+
+  Result _error(Result::Code code, int token, int argument,
+                StringView text = StringView()) const {
+    if (argument < 0) {
+      return Result(code, argument, token, StringView(), text);
+    }
+    const Argument &a = _arguments[static_cast<size_t>(argument)];
+    return Result(code, argument, token, a._names[0], text, a._position);
+  }
+
+  // Appends text, breaking it at spaces so no line runs past width. Lines
+  // after the first are indented to line up under the first.
+  static void _wrap(std::string &out, const std::string &text, size_t indent,
+                    size_t width) {
+    if (width <= indent + 20 || indent + text.size() <= width) {
+      out += text;
+      return;
+    }
+    size_t room = width - indent;
+    size_t begin = 0;
+    while (text.size() - begin > room) {
+      size_t end = text.rfind(' ', begin + room);
+      if (end == std::string::npos || end <= begin) {
+        end = text.find(' ', begin + room);
+        if (end == std::string::npos) {
+          break;
+        }
+      }
+      out.append(text, begin, end - begin);
+      out += "\n";
+      out.append(indent, ' ');
+      begin = end + 1;
+    }
+    out.append(text, begin, std::string::npos);
+  }
+
+  const ParsedArgument *_find(const ParseResult &result,
+                              StringView name) const {
+    int i = _name_map.find(detail::_strip_dashes(name));
+    if (i >= 0 && static_cast<size_t>(i) < result._arguments.size()) {
+      return &result._arguments[static_cast<size_t>(i)];
+    }
+    return nullptr;
+  }
+
+  void _prepare(ParseResult &result) const {
+    if (result._parser != this || result._schema != _arguments.data() ||
+        result._arguments.size() != _arguments.size()) {
+      // a result new to these arguments starts out clearing all of them,
+      // later parses only the ones they touched
+      result._parser = this;
+      result._schema = _arguments.data();
+      result._arguments.resize(_arguments.size());
+      result._touched.clear();
+      for (size_t i = 0; i < _arguments.size(); ++i) {
+        result._arguments[i]._stats = result._stats;
+        result._touch(static_cast<int>(i))._argument = &_arguments[i];
+      }
+    }
+    result.reset();
+    result._prepared = true;
+    result._on_argument = nullptr;
+    if (result._stats) {
+      ++result._stats->parses;
+      result._retained_at_begin = result._retained_bytes();
+    }
+  }
+
+  // Whether begin() prepared result for this parser and it has not finished
+  bool _begun(const ParseResult &result) const {
+    return result._prepared && result._parser == this;
+  }
+
+  Result _finish(ParseResult &result) const {
+    result._prepared = false;
+    if (!result._stats) {
+      return _check(result);
+    }
+    ParseStats &stats = *result._stats;
+    std::chrono::nanoseconds conversion = stats.conversion_time;
+    std::chrono::nanoseconds validation{0};
+    Result err;
+    {
+      detail::stopwatch timer(&validation);
+      err = _check(result);
+    }
+    // eager conversions were timed as conversion already
+    stats.validation_time += validation - (stats.conversion_time - conversion);
+    for (size_t i : result._touched) {
+      stats.values += result._arguments[i]._values.size();
+    }
+    size_t retained = result._retained_bytes();
+    if (retained > result._retained_at_begin) {
+      stats.allocated_bytes += retained - result._retained_at_begin;
+    }
+    stats.retained_bytes = retained + _retained_bytes();
+    return err;
+  }
+
+  // Memory held by the parser for its arguments and lookup tables
+  size_t _retained_bytes() const {
+    size_t n = sizeof(*this) + _bin.capacity() + _desc.capacity() +
+               _arguments.capacity() * sizeof(Argument) +
+               (_positional.capacity() + _expected.capacity() +
+                _typed.capacity()) *
+                   sizeof(int) +
+               _name_map.retained_bytes() + _subcommand_map.retained_bytes() +
+               _completion_names.capacity() * sizeof(completion_name) +
+               (_suggestions ? _suggestions->retained_bytes() : 0) +
+               (_config ? _config->retained_bytes() : 0) +
+               _help.text.capacity();
+    for (auto &a : _arguments) {
+      n += a._names.capacity() * sizeof(std::string) + a._desc.capacity() +
+           a._eager.capacity() * sizeof(a._eager[0]) +
+           a._actions.capacity() * sizeof(a._actions[0]);
+      for (auto &name : a._names) {
+        n += name.capacity();
+      }
+    }
+    return n;
+  }
+
+  // Checks run once every token has been parsed
+  Result _check(ParseResult &result) const {
+    Result err = _flush(result);
+    if (err) {
+      return err;
+    }
+    if (result._subcommand >= 0) {
+      err = _subcommand_parser(result._subcommand)
+                ._finish(*result._subcommand_result);
+      if (err) {
+        return err;
+      }
+    }
+    // what is left concerns the command line as a whole
+    result._token_index = -1;
+    if (_help_enabled &&
+        result._arguments[static_cast<size_t>(_help_index)]._found) {
+      return Result();
+    }
+    err = _end_argument(result);
+    if (err) {
+      return err;
+    }
+    err = _read_config(result);
+    if (err) {
+      return err;
+    }
+    if (_greedy >= 0 &&
+        result._arguments[static_cast<size_t>(_greedy)]._found) {
+      err = _complete(result, _greedy);
+      if (err) {
+        return err;
+      }
+    }
+    err = _check_positional(result, _last);
+    for (size_t p = 0; !err && p < _positional.size(); ++p) {
+      if (p == 0 || _positional[p] != _positional[p - 1]) {
+        err = _check_positional(result, _positional[p]);
+      }
+    }
+    if (!err) {
+      err = _check_positional(result, _greedy);
+    }
+    if (err) {
+      return err;
+    }
+    for (int i : _expected) {
+      const Argument &a = _arguments[static_cast<size_t>(i)];
+      bool found = result._arguments[static_cast<size_t>(i)]._found;
+      if (a._required && !found) {
+        return _error(Result::REQUIRED_NOT_FOUND, -1, i);
+      }
+      if (a._position >= 0 && result._index + 1 >= a._position && !found) {
+        return _error(Result::POSITIONAL_NOT_FOUND, -1, i);
+      }
+      size_t values = result._arguments[static_cast<size_t>(i)]._values.size();
+      if (found && a._position >= 0 && a._positions > 0 &&
+          values < static_cast<size_t>(a._positions)) {
+        // a range cut short, reported at its first empty position
+        return Result(Result::POSITIONAL_NOT_FOUND, i, -1, a._names[0],
+                      StringView(), a._position + static_cast<int>(values));
+      }
+    }
+    for (int i : _typed) {
+      for (auto &e : _arguments[static_cast<size_t>(i)]._eager) {
+        e(result._arguments[static_cast<size_t>(i)]);
+      }
+    }
+    return Result();
+  }
+
+  // Reads the config file into config, tokenizing values in place in the
+  // mapped file and copying them out, so parses only hand them on. An error
+  // in the file is kept for every parse to report.
+  void _load_config(config_state &config) const {
+    if (_config_path.empty()) {
+      return;
+    }
+    detail::mapped_file file;
+    if (!file.open(_config_path)) {
+      if (_config_required) {
+        config.error =
+            _error(Result::CONFIG_FILE_UNREADABLE, -1, -1, _config_path);
+      }
+      return;
+    }
+    config.text.reserve(file.size());
+    std::string name;
+    size_t section = 0;
+    int number = 0;
+    char *end = file.data() + file.size();
+    char *next = nullptr;
+    for (char *line = file.data(); line < end; line = next) {
+      ++number;
+      char *eol = std::find(line, end, '\n');
+      next = eol == end ? end : eol + 1;
+      StringView text =
+          detail::_trim(StringView(line, static_cast<size_t>(eol - line)));
+      if (text.empty() || text[0] == '#' || text[0] == ';') {
+        continue;
+      }
+      if (text[0] == '[') {
+        if (text[text.size() - 1] != ']') {
+          config.error = Result(Result::CONFIG_LINE_MALFORMED, -1, -1,
+                                StringView(), text, number);
+          return;
+        }
+        StringView scope = detail::_trim(text.substr(1, text.size() - 2));
+        name.assign(scope.data(), scope.size());
+        if (!name.empty()) {
+          name += '.';
+        }
+        section = name.size();
+        continue;
+      }
+      const char *equal = std::find(text.begin(), text.end(), '=');
+      StringView key = detail::_trim(
+          StringView(text.data(), static_cast<size_t>(equal - text.data())));
+      if (key.empty()) {
+        config.error = Result(Result::CONFIG_LINE_MALFORMED, -1, -1,
+                              StringView(), text, number);
+        return;
+      }
+      name.resize(section);
+      name.append(key.data(), key.size());
+      int index = _name_map.find(name);
+      if (index < 0) {
+        config.error = Result(Result::CONFIG_KEY_UNKNOWN, -1, -1,
+                              StringView(), key, number);
+        return;
+      }
+      config_line entry{index, config.values.size(), 0, true};
+      if (equal != text.end()) {
+        char *in = line + (equal + 1 - line);
+        char *value_end = line + (text.end() - line);
+        StringView token;
+        while (detail::_next_token(in, value_end, token)) {
+          config.values.push_back({config.text.size(), token.size()});
+          config.text.append(token.data(), token.size());
+          ++entry.count;
+        }
+      }
+      const Argument &a = _arguments[static_cast<size_t>(index)];
+      if (a._count == 0 && entry.count > 0) {
+        StringView value = config.value(entry.first);
+        if (entry.count > 1 ||
+            detail::_convert(value, entry.set) != detail::CONVERSION_OK) {
+          config.error = _error(Result::INVALID_VALUE, -1, index, value);
+          return;
+        }
+        config.values.resize(entry.first);
+        entry.count = 0;
+      }
+      config.lines.push_back(entry);
+    }
+  }
+
+  // Fills in the arguments the command line left out from the config file,
+  // one line at a time. The first parse after compile() reads the file.
+  Result _read_config(ParseResult &result) const {
+    if (_config_path.empty()) {
+      return Result();
+    }
+    config_state &config = *_config;
+    std::call_once(config.loaded, [this, &config] { _load_config(config); });
+    if (config.error) {
+      return config.error;
+    }
+    for (auto &entry : config.lines) {
+      ParsedArgument &pa = result._touch(entry.argument);
+      if (pa._found && !pa._from_config) {
+        // the command line takes precedence
+        continue;
+      }
+      pa._values.clear();
+      for (size_t i = 0; i < entry.count; ++i) {
+        pa._values.push_back(config.value(entry.first + i));
+      }
+      pa._found = entry.set;
+      pa._from_config = true;
+      if (pa._found) {
+        result._current = entry.argument;
+        Result err = _end_argument(result);
+        if (err) {
+          return err;
+        }
+      }
+    }
+    return Result();
+  }
+
+  // Argument index claiming position after the argument taken already has.
+  // The position is reported as declared, without the executable's name.
+  Result _position_taken(int index, int taken, int position) const {
+    return Result(Result::POSITION_TAKEN, index, -1,
+                  _arguments[static_cast<size_t>(index)]._names[0],
+                  _arguments[static_cast<size_t>(taken)]._names[0],
+                  position < 0 ? position : position - 1);
+  }
+
+  // Closest name to the unrecognized option text, with its dashes
+  static std::string _suggest(const void *names, StringView text) {
+    return static_cast<const detail::suggestion_index *>(names)->closest(text);
+  }
+
+  // Writes the names completing the last of count words, see complete()
+  void _completions(const char *const *words, int count,
+                    std::ostream &os) const {
+    for (int i = 0; i + 1 < count; ++i) {
+      StringView word(words[i]);
+      int c = word.empty() ? -1 : _subcommand_map.find(word);
+      if (c >= 0) {
+        const ArgumentParser &parser = _subcommand_parser(c);
+        if (!_subcommands[static_cast<size_t>(c)]->compiled) {
+          parser._completions(words + i + 1, count - i - 1, os);
+        }
+        return;
+      }
+    }
+    StringView prefix = count > 0 ? StringView(words[count - 1]) : "";
+    bool options = !prefix.empty() && prefix[0] == '-';
+    auto it = std::lower_bound(
+        _completion_names.begin(), _completion_names.end(), prefix,
+        [](const completion_name &n, StringView p) { return n.name < p; });
+    for (; it != _completion_names.end() &&
+           it->name.substr(0, prefix.size()) == prefix;
+         ++it) {
+      if ((it->name[0] == '-') != options) {
+        continue;
+      }
+      os << it->name << '\t';
+      for (char c : *it->desc) {
+        os << (c == '\n' || c == '\t' ? ' ' : c);
+      }
+      os << '\n';
+    }
+  }
+
+  // Whether the open argument, if any, is still short of its count
+  bool _needs_value(const ParseResult &result) const {
+    if (result._current < 0) {
+      return false;
+    }
+    int count = _arguments[static_cast<size_t>(result._current)]._count;
+    return count > 0 &&
+           result._arguments[static_cast<size_t>(result._current)]
+                   ._values.size() < static_cast<size_t>(count);
+  }
+
+  Result _begin_subcommand(ParseResult &result, int index) const {
+    Result err = _end_argument(result);
+    if (err) {
+      return err;
+    }
+    const ArgumentParser &parser = _subcommand_parser(index);
+    const Result &compiled = _subcommands[static_cast<size_t>(index)]->compiled;
+    if (compiled) {
+      return compiled;
+    }
+    if (!result._subcommand_result) {
+      result._subcommand_result = std::make_shared<ParseResult>();
+    }
+    result._subcommand = index;
+    result._subcommand_result->_run_actions = result._run_actions;
+    return parser.begin(*result._subcommand_result);
+  }
+
+  // Builds the subcommand's parser the first time it is needed, once even
+  // when several threads parse at the same time. Whether it compiled is
+  // kept in the command.
+  const ArgumentParser &_subcommand_parser(int index) const {
+    command &c = *_subcommands[static_cast<size_t>(index)];
+    std::call_once(c.once, [this, &c]() {
+      c.parser = std::make_shared<ArgumentParser>(_bin + " " + c.name, c.desc);
+      if (c.factory) {
+        c.factory(*c.parser);
+      }
+      c.compiled = c.parser->compile();
+    });
+    return *c.parser;
+  }
+
+  StringView _subcommand_name(int index) const {
+    return _subcommands[static_cast<size_t>(index)]->name;
+  }
+
+  // Hands the next token to the parser. When an argument takes the last
+  // position, tokens are processed one behind, as a token is only known not
+  // to be the last one once the next arrives.
+  Result _push(ParseResult &result, StringView token) const {
+    int index = ++result._index;
+    if (result._stats) {
+      ++result._stats->tokens;
+    }
+    if (token.empty()) {
+      return Result();
+    }
+    if (_last < 0) {
+      return _token(result, token, index, false);
+    }
+    Result err;
+    if (result._pending_index > 0) {
+      err = _token(result, result._pending, result._pending_index, false);
+    }
+    result._pending = token;
+    result._pending_index = index;
+    return err;
+  }
+
+  // Processes the token held back by _push as the last one
+  Result _flush(ParseResult &result) const {
+    if (result._pending_index > 0) {
+      int index = result._pending_index;
+      result._pending_index = 0;
+      return _token(result, result._pending, index, true);
     }
-    return false;
+    return Result();
   }
 
-  template <typename T>
-  T get(const std::string &name) {
-    auto t = _name_map.find(name);
-    if (t != _name_map.end()) {
-      return _arguments[static_cast<size_t>(t->second)].get<T>();
+  Result _token(ParseResult &result, StringView current_arg, int index,
+                bool last) const {
+    result._token_index = index;
+    if (result._subcommand >= 0) {
+      return _subcommand_parser(result._subcommand)
+          ._push(*result._subcommand_result, current_arg);
+    }
+    if (result._stats && !_subcommands.empty()) {
+      ++result._stats->lookups;
+    }
+    if (!_subcommands.empty() && current_arg[0] != '-' &&
+        _subcommand_map.find(current_arg) >= 0 && !_needs_value(result)) {
+      return _begin_subcommand(result, _subcommand_map.find(current_arg));
+    }
+    Result err;
+    size_t arg_len = current_arg.length();
+    if (_help_enabled && (current_arg == "-h" || current_arg == "--help")) {
+      result._touch(_help_index)._found = true;
+    } else if (last && _last >= 0) {
+      err = _end_argument(result);
+      Result b = err;
+      err = _add_value(result, current_arg, Argument::Position::LAST);
+      if (b) {
+        return b;
+      }
+      if (err) {
+        return err;
+      }
+    } else if (arg_len >= 2 &&
+               !detail::_is_number(current_arg)) {  // ignores the case if
+                                                    // the arg is just a -
+      // look for -a (short) or --arg (long) args
+      if (current_arg[0] == '-') {
+        err = _end_argument(result);
+        if (err) {
+          return err;
+        }
+        // look for --arg (long) args
+        if (current_arg[1] == '-') {
+          err = _begin_argument(result, current_arg.substr(2), true, index);
+          if (err) {
+            return err;
+          }
+        } else {  // short args
+          err = _begin_argument(result, current_arg.substr(1), false, index);
+          if (err) {
+            return err;
+          }
+        }
+      } else {  // argument value
+        err = _add_value(result, current_arg, index);
+        if (err) {
+          return err;
+        }
+      }
+    } else {  // argument value
+      err = _add_value(result, current_arg, index);
+      if (err) {
+        return err;
+      }
     }
-    return T();
+    return Result();
   }
 
- private:
-  Result _begin_argument(const std::string &arg, bool longarg, int position) {
-    auto it = _positional_arguments.find(position);
-    if (it != _positional_arguments.end()) {
-      Result err = _end_argument();
-      Argument &a = _arguments[static_cast<size_t>(it->second)];
-      a._values.push_back((longarg ? "--" : "-") + arg);
-      a._found = true;
-      return err;
+  // Maps the response file at path and pushes its tokens, expanding the
+  // response files it names in turn. open_files holds the files being
+  // expanded, so a file that names itself is caught.
+  Result _expand(ParseResult &result, StringView path,
+                 std::vector<const detail::mapped_file *> &open_files) const {
+    std::shared_ptr<detail::mapped_file> file =
+        std::make_shared<detail::mapped_file>();
+    if (!file->open(path.str())) {
+      return _error(Result::RESPONSE_FILE_UNREADABLE, -1, -1, path);
     }
-    if (_current != -1) {
-      return Result("Current argument left open");
+    for (auto f : open_files) {
+      if (f->same_file(*file)) {
+        return _error(Result::RESPONSE_FILE_CYCLE, -1, -1, path);
+      }
+    }
+    result._files.push_back(file);
+    open_files.push_back(file.get());
+    char *in = file->data();
+    char *end = in + file->size();
+    StringView token;
+    Result err;
+    while (!err && detail::_next_token(in, end, token)) {
+      if (token.size() > 1 && token[0] == '@') {
+        err = _expand(result, token.substr(1), open_files);
+      } else {
+        err = _push(result, token);
+      }
+    }
+    open_files.pop_back();
+    return err;
+  }
+
+  Result _begin_argument(ParseResult &result, StringView arg, bool longarg,
+                         int position) const {
+    int positional = _positional_at(position);
+    if (positional >= 0) {
+      Result err = _end_argument(result);
+      // arg is the token with its dashes stripped, so widen the view back
+      size_t dashes = longarg ? 2 : 1;
+      Result value = _positional_value(
+          result, positional,
+          StringView(arg.data() - dashes, arg.size() + dashes));
+      return err ? err : value;
+    }
+    if (result._current != -1) {
+      return _error(Result::ARGUMENT_LEFT_OPEN, position, result._current);
     }
     size_t name_end = detail::_find_name_end(arg);
-    std::string arg_name = arg.substr(0, name_end);
+    StringView arg_name = arg.substr(0, name_end);
     if (longarg) {
       int equal_pos = detail::_find_equal(arg);
-      auto nmf = _name_map.find(arg_name);
-      if (nmf == _name_map.end()) {
-        return Result("Unrecognized command line option '" + arg_name + "'");
+      int nmf = _name_map.find(arg_name);
+      if (result._stats) {
+        ++result._stats->lookups;
+      }
+      if (nmf < 0) {
+        Result err =
+            _error(Result::UNRECOGNIZED_OPTION, position, -1, arg_name);
+        err._suggest = &ArgumentParser::_suggest;
+        err._source = _suggestions;
+        return err;
       }
-      _current = nmf->second;
-      _arguments[static_cast<size_t>(nmf->second)]._found = true;
+      result._current = nmf;
+      result._touch(nmf)._found = true;
       if (equal_pos == 0 ||
           (equal_pos < 0 &&
            arg_name.length() < arg.length())) {  // malformed argument
-        return Result("Malformed argument: " + arg);
+        return _error(Result::MALFORMED_ARGUMENT, position, nmf, arg);
       } else if (equal_pos > 0) {
-        std::string arg_value = arg.substr(name_end + 1);
-        _add_value(arg_value, position);
+        StringView arg_value = arg.substr(name_end + 1);
+        Result err = _add_value(result, arg_value, position);
+        if (err) {
+          return err;
+        }
+      }
+      if (result._current == nmf &&
+          _arguments[static_cast<size_t>(nmf)]._count == 0) {
+        // a flag is complete as soon as it is seen
+        return _end_argument(result);
       }
     } else {
-      Result r;
-      if (arg_name.length() == 1) {
-        return _begin_argument(arg, true, position);
-      } else {
-        for (char &c : arg_name) {
-          r = _begin_argument(std::string(1, c), true, position);
-          if (r) {
-            return r;
-          }
-          r = _end_argument();
-          if (r) {
-            return r;
-          }
-        }
+      return _begin_short(result, arg, position);
+    }
+    return Result();
+  }
+
+  // Resolves a cluster of short options such as -xvzf with one table load
+  // per character. An option taking values ends the cluster, the rest of
+  // it being its first value (-j8, -ofile); one taking any number of values
+  // only does so when the next character is not a short option itself. The
+  // last option of a cluster is left open for the tokens that follow.
+  Result _begin_short(ParseResult &result, StringView arg,
+                      int position) const {
+    for (size_t i = 0; i < arg.size(); ++i) {
+      if (i + 1 < arg.size() && arg[i + 1] == '=') {
+        // -v=1 reads like --v=1
+        return _begin_argument(result, arg.substr(i), true, position);
+      }
+      int index = _short[static_cast<unsigned char>(arg[i])];
+      if (result._stats) {
+        ++result._stats->lookups;
+      }
+      if (index < 0) {
+        return _error(Result::UNRECOGNIZED_OPTION, position, -1,
+                      arg.substr(i, 1));
+      }
+      result._current = index;
+      result._touch(index)._found = true;
+      if (i + 1 == arg.size()) {
+        break;
+      }
+      int count = _arguments[static_cast<size_t>(index)]._count;
+      if (count > 0 ||
+          (count < 0 && _short[static_cast<unsigned char>(arg[i + 1])] < 0)) {
+        return _add_value(result, arg.substr(i + 1), position);
+      }
+      Result err = _end_argument(result);
+      if (err) {
+        return err;
       }
     }
+    if (result._current >= 0 &&
+        _arguments[static_cast<size_t>(result._current)]._count == 0) {
+      return _end_argument(result);
+    }
     return Result();
   }
 
-  Result _add_value(const std::string &value, int location) {
-    if (_current >= 0) {
-      Result err;
-      Argument &a = _arguments[static_cast<size_t>(_current)];
-      if (a._count >= 0 && static_cast<int>(a._values.size()) >= a._count) {
-        err = _end_argument();
-        if (err) {
-          return err;
+  // Adds value to the open argument, or once that has all its values to the
+  // positional argument taking location. A value neither takes fails the
+  // parse unless free values are enabled: with TOO_MANY_VALUES when the open
+  // argument, given again or as --flag=value, already had all its values,
+  // and with UNKNOWN_ARGUMENT otherwise.
+  Result _add_value(ParseResult &result, StringView value,
+                    int location) const {
+    int refused = -1;
+    if (result._current >= 0) {
+      const Argument &a = _arguments[static_cast<size_t>(result._current)];
+      ParsedArgument &pa = result._touch(result._current);
+      if (a._count < 0 || static_cast<int>(pa._values.size()) < a._count) {
+        pa._values.push_back(value);
+        if (a._count >= 0 && static_cast<int>(pa._values.size()) >= a._count) {
+          return _end_argument(result);
         }
-        goto unnamed;
+        return Result();
       }
-      a._values.push_back(value);
-      if (a._count >= 0 && static_cast<int>(a._values.size()) >= a._count) {
-        err = _end_argument();
-        if (err) {
-          return err;
-        }
+      refused = result._current;
+      Result err = _end_argument(result);
+      if (err) {
+        return err;
       }
+    }
+    int positional = _positional_at(location);
+    if (positional >= 0) {
+      return _positional_value(result, positional, value);
+    }
+    if (_free_values) {
       return Result();
-    } else {
-    unnamed:
-      auto it = _positional_arguments.find(location);
-      if (it != _positional_arguments.end()) {
-        Argument &a = _arguments[static_cast<size_t>(it->second)];
-        a._values.push_back(value);
-        a._found = true;
-      }
-      // TODO
-      return Result();
     }
+    if (refused >= 0) {
+      return _error(Result::TOO_MANY_VALUES, result._token_index, refused,
+                    value);
+    }
+    return _error(Result::UNKNOWN_ARGUMENT, result._token_index, -1, value);
   }
 
-  Result _end_argument() {
-    if (_current >= 0) {
-      Argument &a = _arguments[static_cast<size_t>(_current)];
-      _current = -1;
-      if (static_cast<int>(a._values.size()) < a._count) {
-        return Result("Too few arguments given for " + a._names[0]);
+  Result _end_argument(ParseResult &result) const {
+    if (result._current >= 0) {
+      const Argument &a = _arguments[static_cast<size_t>(result._current)];
+      const ParsedArgument &pa =
+          result._arguments[static_cast<size_t>(result._current)];
+      result._current = -1;
+      if (static_cast<int>(pa._values.size()) < a._count) {
+        return _error(Result::TOO_FEW_VALUES, result._token_index, a._index);
       }
       if (a._count >= 0) {
-        if (static_cast<int>(a._values.size()) > a._count) {
-          return Result("Too many arguments given for " + a._names[0]);
+        if (static_cast<int>(pa._values.size()) > a._count) {
+          return _error(Result::TOO_MANY_VALUES, result._token_index,
+                        a._index);
+        }
+      }
+      return _complete(result, a._index);
+    }
+    return Result();
+  }
+
+  // Argument taking the token at position, or -1
+  int _positional_at(int position) const {
+    if (position == Argument::Position::LAST) {
+      return _last;
+    }
+    if (position >= 0 && static_cast<size_t>(position) < _positional.size() &&
+        _positional[static_cast<size_t>(position)] >= 0) {
+      return _positional[static_cast<size_t>(position)];
+    }
+    if (_greedy >= 0 && position >= _greedy_position) {
+      return _greedy;
+    }
+    return -1;
+  }
+
+  // A positional argument is complete once it has a value for every
+  // position it takes; one taking all remaining tokens completes at the end
+  Result _positional_value(ParseResult &result, int index,
+                           StringView value) const {
+    ParsedArgument &a = result._touch(index);
+    a._values.push_back(value);
+    a._found = true;
+    if (static_cast<int>(a._values.size()) ==
+        _arguments[static_cast<size_t>(index)]._positions) {
+      return _complete(result, index);
+    }
+    return Result();
+  }
+
+  // An option where a positional argument was expected is an error
+  Result _check_positional(const ParseResult &result, int index) const {
+    if (index < 0) {
+      return Result();
+    }
+    const ParsedArgument &pa = result._arguments[static_cast<size_t>(index)];
+    if (pa._values.size() > 0 && !pa._values[0].empty() &&
+        pa._values[0][0] == '-' &&
+        _name_map.find(detail::_strip_dashes(pa._values[0])) >= 0) {
+      return _error(Result::OPTION_IN_POSITION, -1, index, pa._values[0]);
+    }
+    return Result();
+  }
+
+  void _usage_name(std::string &out, int index, const char *close) const {
+    StringView name =
+        detail::_strip_dashes(_arguments[static_cast<size_t>(index)]._names[0]);
+    out += " [";
+    out.append(name.data(), name.size());
+    out += close;
+  }
+
+  Result _complete(const ParseResult &result, int index) const {
+    const ParsedArgument &a = result._arguments[static_cast<size_t>(index)];
+    // values converted when the argument last completed are stale now
+    a._clear_cache();
+    if (result._run_actions) {
+      for (auto &action : _arguments[static_cast<size_t>(index)]._actions) {
+        Result err = action(a);
+        if (err) {
+          err._token = result._token_index;
+          return err;
         }
       }
     }
+    if (result._on_argument) {
+      result._on_argument(a);
+    }
     return Result();
   }
 
   bool _help_enabled{false};
-  int _current{-1};
+  bool _zero_copy{false};
+  bool _response_files{false};
+  bool _free_values{false};
+  std::string _config_path{};
+  bool _config_required{false};
+  // replaced by every compile(), shared with copies of the parser
+  std::shared_ptr<config_state> _config{};
   std::string _bin{};
   std::string _desc{};
   std::vector<Argument> _arguments{};
-  std::map<int, int> _positional_arguments{};
-  std::map<std::string, int> _name_map{};
+  // argument index for each position, -1 where none is declared
+  std::vector<int> _positional{};
+  // argument taking every token from _greedy_position on
+  int _greedy{-1};
+  int _greedy_position{0};
+  int _last{-1};
+  // arguments that are required or positional, checked after every parse
+  std::vector<int> _expected{};
+  // arguments with types to convert to after every parse
+  std::vector<int> _typed{};
+  detail::name_index _name_map{};
+  // argument index for each single character name, -1 for none
+  std::array<int, 256> _short{};
+  struct command {
+    std::string name{};
+    std::string desc{};
+    std::function<void(ArgumentParser &)> factory{};
+    std::once_flag once{};
+    std::shared_ptr<ArgumentParser> parser{};
+    // what compiling parser returned
+    Result compiled{};
+  };
+  std::vector<std::shared_ptr<command>> _subcommands{};
+  detail::name_index _subcommand_map{};
+  // every argument and subcommand name, sorted for prefix queries
+  struct completion_name {
+    StringView name;
+    const std::string *desc;
+  };
+  std::vector<completion_name> _completion_names{};
+  // names suggested for unrecognized options, built by compile()
+  std::shared_ptr<const detail::suggestion_index> _suggestions{};
+  bool _compiled{false};
+  int _help_index{-1};
+  std::shared_ptr<ParseResult> _result{};
+  // rendered help, kept until the arguments change
+  struct {
+    std::string text;
+    size_t count;
+    size_t page;
+    size_t width;
+    bool valid;
+  } _help{std::string(), 0, 0, 0, false};
+  size_t _help_column{23};
 };
 
 std::ostream &operator<<(std::ostream &os, const ArgumentParser::Result &r) {
@@ -553,14 +3726,446 @@ std::ostream &operator<<(std::ostream &os, const ArgumentParser::Result &r) {
   return os;
 }
 template <>
-inline std::string ArgumentParser::Argument::get<std::string>() {
+inline std::string ArgumentParser::ParsedArgument::_get<std::string>() const {
   return detail::_join(_values.begin(), _values.end());
 }
 template <>
 inline std::vector<std::string>
-ArgumentParser::Argument::get<std::vector<std::string>>() {
-  return _values;
+ArgumentParser::ParsedArgument::_get<std::vector<std::string>>() const {
+  return std::vector<std::string>(_values.begin(), _values.end());
 }
+inline const std::string &ArgumentParser::ParsedArgument::name() const {
+  return _argument->_names[0];
+}
+
+// Description of an argument that is evaluated entirely at compile time, for
+// use with StaticArgumentParser. Names may be given with or without their
+// leading dashes and either may be empty (but not null). Positions are given
+// the same way as to ArgumentParser::Argument::position.
+class StaticArgument {
+ public:
+  constexpr StaticArgument(
+      const char *short_name, const char *long_name, bool required = false,
+      int count = ArgumentParser::Argument::Count::ANY,
+      int position = ArgumentParser::Argument::Position::DONT_CARE)
+      : _display(*short_name ? short_name : long_name),
+        _short_name(detail::_skip_dashes(short_name)),
+        _long_name(detail::_skip_dashes(long_name)),
+        _short_length(detail::_length(detail::_skip_dashes(short_name))),
+        _long_length(detail::_length(detail::_skip_dashes(long_name))),
+        _short_hash(detail::_hash(detail::_skip_dashes(short_name))),
+        _long_hash(detail::_hash(detail::_skip_dashes(long_name))),
+        _required(required),
+        _count(count),
+        // position + 1 because argument zero is the name of the executable
+        _position(position >= 0 ? position + 1 : position) {}
+
+ private:
+  template <size_t N>
+  friend class StaticArgumentParser;
+
+  const char *_display;
+  const char *_short_name;
+  const char *_long_name;
+  size_t _short_length;
+  size_t _long_length;
+  uint32_t _short_hash;
+  uint32_t _long_hash;
+  bool _required;
+  int _count;
+  int _position;
+};
+
+// Parser for a schema fixed at compile time. The names, their hashes, counts
+// and positions all come from a constexpr array of StaticArgument, the name
+// table is a fixed size hash table sized from N, and required/found
+// validation is done on bitsets, so nothing is allocated on the heap to set
+// up the parser or to parse a command line that is valid. Values are views
+// into argv, which must outlive the parser's results. Each occurrence of an
+// argument replaces the values of the previous one.
+//
+//   static constexpr StaticArgument args[] = {
+//       {"-v", "--verbose"}, {"-o", "--output", true, 1}};
+//   StaticArgumentParser<2> parser(args);
+template <size_t N>
+class StaticArgumentParser {
+ public:
+  using Result = ArgumentParser::Result;
+
+  explicit StaticArgumentParser(const StaticArgument (&args)[N])
+      : _args(args) {
+    _table.fill(-1);
+    _short.fill(-1);
+    for (size_t i = 0; i < N; ++i) {
+      const StaticArgument &a = _args[i];
+      _insert_short(a._short_name, a._short_length, i);
+      _insert_short(a._long_name, a._long_length, i);
+      if (!_insert(a._short_name, a._short_length, a._short_hash, i) ||
+          !_insert(a._long_name, a._long_length, a._long_hash, i)) {
+        _duplicate = static_cast<int>(i);
+      }
+      _required[i] = a._required;
+      if (a._position >= 0) {
+        _positional[_positional_count++] = static_cast<int>(i);
+      } else if (a._position == ArgumentParser::Argument::Position::LAST) {
+        _last = static_cast<int>(i);
+      }
+    }
+  }
+
+  Result parse(int argc, const char *argv[]) {
+    _argv = argv;
+    _current = -1;
+    _found.reset();
+    _slots.fill(slot());
+    if (_duplicate >= 0) {
+      return _error(Result::DUPLICATE_NAME, _duplicate,
+                    _args[_duplicate]._display);
+    }
+    Result err;
+    for (int i = 1; i < argc; ++i) {
+      StringView token(argv[i]);
+      if (token.empty()) {
+        continue;
+      }
+      _token = i;
+      if (i == argc - 1 && _last >= 0) {
+        err = _end_argument();
+        _set_positional(_last, i);
+      } else if (token.size() >= 2 && token[0] == '-' &&
+                 !detail::_is_number(token)) {
+        err = _end_argument();
+        if (!err) {
+          int p = _positional_at(i);
+          if (p >= 0) {
+            _set_positional(p, i);
+          } else if (token[1] == '-') {
+            err = _begin_argument(token.substr(2), i);
+          } else {
+            err = _begin_short(token.substr(1), i);
+          }
+        }
+      } else {
+        err = _add_value(i);
+      }
+      if (err) {
+        return err;
+      }
+    }
+    _token = -1;
+    err = _end_argument();
+    if (err) {
+      return err;
+    }
+    for (size_t p = 0; p < _positional_count + (_last >= 0); ++p) {
+      int i = p < _positional_count ? _positional[p] : _last;
+      StringView v = _value(static_cast<size_t>(i), 0);
+      if (!v.empty() && v[0] == '-' && _find(detail::_strip_dashes(v)) >= 0) {
+        return _error(Result::OPTION_IN_POSITION, i, v);
+      }
+    }
+    std::bitset<N> missing = _required & ~_found;
+    for (size_t i = 0; i < N; ++i) {
+      if (missing[i]) {
+        return _error(Result::REQUIRED_NOT_FOUND, static_cast<int>(i));
+      }
+      if (_args[i]._position >= 0 && argc >= _args[i]._position &&
+          !_found[i]) {
+        return _error(Result::POSITIONAL_NOT_FOUND, static_cast<int>(i));
+      }
+    }
+    return Result();
+  }
+
+  bool exists(StringView name) const {
+    int i = _find(detail::_strip_dashes(name));
+    return i >= 0 && _found[static_cast<size_t>(i)];
+  }
+
+  // number of values given for the argument
+  size_t count(StringView name) const {
+    int i = _find(detail::_strip_dashes(name));
+    return i >= 0 ? _count(static_cast<size_t>(i)) : 0;
+  }
+
+  StringView value(StringView name, size_t n = 0) const {
+    int i = _find(detail::_strip_dashes(name));
+    return i >= 0 ? _value(static_cast<size_t>(i), n) : StringView();
+  }
+
+  template <typename T>
+  typename std::enable_if<detail::is_vector<T>::value, T>::type get(
+      StringView name) const {
+    T t = T();
+    int i = _find(detail::_strip_dashes(name));
+    if (i >= 0) {
+      for (size_t n = 0; n < _count(static_cast<size_t>(i)); ++n) {
+        typename T::value_type vt = typename T::value_type();
+        if (detail::_convert(_value(static_cast<size_t>(i), n), vt) !=
+            detail::CONVERSION_OK) {
+          vt = typename T::value_type();
+        }
+        t.push_back(vt);
+      }
+    }
+    return t;
+  }
+
+  template <typename T>
+  typename std::enable_if<!detail::is_vector<T>::value, T>::type get(
+      StringView name) const {
+    T t = T();
+    if (detail::_convert(value(name), t) != detail::CONVERSION_OK) {
+      return T();
+    }
+    return t;
+  }
+
+ private:
+  // values of an argument are the inline --name=value, if any, followed by
+  // the run of tokens [begin, end)
+  struct slot {
+    StringView inline_value{};
+    int begin{0};
+    int end{0};
+  };
+
+  static constexpr size_t _table_size = detail::_next_pow2(N * 4);
+
+  bool _insert(const char *name, size_t length, uint32_t hash, size_t arg) {
+    if (length == 0) {
+      return true;
+    }
+    size_t i = hash & (_table_size - 1);
+    while (_table[i] >= 0) {
+      if (_matches(_table[i], StringView(name, length), hash)) {
+        return false;
+      }
+      i = (i + 1) & (_table_size - 1);
+    }
+    // even entries are short names, odd entries long names
+    _table[i] = static_cast<int>(arg * 2) + (name == _args[arg]._long_name);
+    return true;
+  }
+
+  void _insert_short(const char *name, size_t length, size_t arg) {
+    if (length == 1) {
+      _short[static_cast<unsigned char>(name[0])] = static_cast<int>(arg);
+    }
+  }
+
+  bool _matches(int entry, StringView name, uint32_t hash) const {
+    const StaticArgument &a = _args[entry / 2];
+    if (entry % 2) {
+      return a._long_hash == hash && a._long_length == name.size() &&
+             std::memcmp(a._long_name, name.data(), name.size()) == 0;
+    }
+    return a._short_hash == hash && a._short_length == name.size() &&
+           std::memcmp(a._short_name, name.data(), name.size()) == 0;
+  }
+
+  int _find(StringView name) const {
+    if (name.empty()) {
+      return -1;
+    }
+    uint32_t hash = detail::_hash(name);
+    size_t i = hash & (_table_size - 1);
+    while (_table[i] >= 0) {
+      if (_matches(_table[i], name, hash)) {
+        return _table[i] / 2;
+      }
+      i = (i + 1) & (_table_size - 1);
+    }
+    return -1;
+  }
+
+  int _positional_at(int position) const {
+    for (size_t p = 0; p < _positional_count; ++p) {
+      if (_args[_positional[p]]._position == position) {
+        return _positional[p];
+      }
+    }
+    return -1;
+  }
+
+  size_t _count(size_t i) const {
+    const slot &s = _slots[i];
+    return static_cast<size_t>(s.end - s.begin) +
+           (s.inline_value.data() != nullptr);
+  }
+
+  StringView _value(size_t i, size_t n) const {
+    const slot &s = _slots[i];
+    if (s.inline_value.data() != nullptr) {
+      if (n == 0) {
+        return s.inline_value;
+      }
+      --n;
+    }
+    if (n < static_cast<size_t>(s.end - s.begin)) {
+      return StringView(_argv[static_cast<size_t>(s.begin) + n]);
+    }
+    return StringView();
+  }
+
+  void _set_positional(int arg, int position) {
+    _slots[static_cast<size_t>(arg)] = slot();
+    _slots[static_cast<size_t>(arg)].begin = position;
+    _slots[static_cast<size_t>(arg)].end = position + 1;
+    _found[static_cast<size_t>(arg)] = true;
+  }
+
+  Result _begin_argument(StringView arg, int position) {
+    size_t name_end = detail::_find_name_end(arg);
+    StringView name = arg.substr(0, name_end);
+    int equal_pos = detail::_find_equal(arg);
+    int i = _find(name);
+    if (i < 0) {
+      Result err = _error(Result::UNRECOGNIZED_OPTION, -1, name);
+      err._suggest = &StaticArgumentParser::_suggest;
+      // points at the arguments without owning them
+      err._source = std::shared_ptr<const void>(std::shared_ptr<const void>(),
+                                                &_args);
+      return err;
+    }
+    _current = i;
+    _found[static_cast<size_t>(i)] = true;
+    slot &s = _slots[static_cast<size_t>(i)];
+    s = slot();
+    s.begin = s.end = position + 1;
+    if (equal_pos == 0 || (equal_pos < 0 && name_end < arg.size())) {
+      return _error(Result::MALFORMED_ARGUMENT, i, arg);
+    } else if (equal_pos > 0) {
+      s.inline_value = arg.substr(name_end + 1);
+    }
+    if (_args[i]._count >= 0 &&
+        _count(static_cast<size_t>(i)) >=
+            static_cast<size_t>(_args[i]._count)) {
+      return _end_argument();
+    }
+    return Result();
+  }
+
+  // Same cluster rules as ArgumentParser, attached values being kept as
+  // the inline value of the slot
+  Result _begin_short(StringView arg, int position) {
+    for (size_t c = 0; c < arg.size(); ++c) {
+      if (c + 1 < arg.size() && arg[c + 1] == '=') {
+        return _begin_argument(arg.substr(c), position);
+      }
+      int i = _short[static_cast<unsigned char>(arg[c])];
+      if (i < 0) {
+        return _error(Result::UNRECOGNIZED_OPTION, -1, arg.substr(c, 1));
+      }
+      _current = i;
+      _found[static_cast<size_t>(i)] = true;
+      slot &s = _slots[static_cast<size_t>(i)];
+      s = slot();
+      s.begin = s.end = position + 1;
+      if (c + 1 == arg.size()) {
+        break;
+      }
+      int count = _args[i]._count;
+      if (count > 0 ||
+          (count < 0 && _short[static_cast<unsigned char>(arg[c + 1])] < 0)) {
+        s.inline_value = arg.substr(c + 1);
+        break;
+      }
+      Result err = _end_argument();
+      if (err) {
+        return err;
+      }
+    }
+    size_t i = static_cast<size_t>(_current);
+    if (_current >= 0 && _args[i]._count >= 0 &&
+        _count(i) >= static_cast<size_t>(_args[i]._count)) {
+      return _end_argument();
+    }
+    return Result();
+  }
+
+  Result _add_value(int position) {
+    if (_current >= 0) {
+      size_t i = static_cast<size_t>(_current);
+      int count = _args[i]._count;
+      if (count < 0 || _count(i) < static_cast<size_t>(count)) {
+        _slots[i].end = position + 1;
+        if (count >= 0 && _count(i) >= static_cast<size_t>(count)) {
+          return _end_argument();
+        }
+        return Result();
+      }
+      Result err = _end_argument();
+      if (err) {
+        return err;
+      }
+    }
+    int p = _positional_at(position);
+    if (p >= 0) {
+      _set_positional(p, position);
+    }
+    return Result();
+  }
+
+  Result _end_argument() {
+    if (_current >= 0) {
+      size_t i = static_cast<size_t>(_current);
+      _current = -1;
+      int count = _args[i]._count;
+      if (count >= 0 && _count(i) < static_cast<size_t>(count)) {
+        return _error(Result::TOO_FEW_VALUES, static_cast<int>(i));
+      }
+      if (count >= 0 && _count(i) > static_cast<size_t>(count)) {
+        return _error(Result::TOO_MANY_VALUES, static_cast<int>(i));
+      }
+    }
+    return Result();
+  }
+
+  static std::string _suggest(const void *args, StringView text) {
+    typedef const StaticArgument(arguments)[N];
+    arguments &a = *static_cast<arguments *>(args);
+    detail::edit_distance distance(text);
+    size_t best = detail::_suggestion_bound(text.size());
+    std::string name;
+    for (size_t i = 0; i < N; ++i) {
+      const char *names[] = {a[i]._long_name, a[i]._short_name};
+      size_t lengths[] = {a[i]._long_length, a[i]._short_length};
+      for (size_t k = 0; k < 2; ++k) {
+        size_t d = distance(StringView(names[k], lengths[k]), best);
+        if (lengths[k] > 0 && (d < best || (d == best && name.empty()))) {
+          best = d;
+          name.assign(lengths[k] == 1 ? "-" : "--");
+          name.append(names[k], lengths[k]);
+        }
+      }
+    }
+    return name;
+  }
+
+  Result _error(Result::Code code, int argument,
+                StringView text = StringView()) const {
+    if (argument < 0) {
+      return Result(code, argument, _token, StringView(), text);
+    }
+    const StaticArgument &a = _args[static_cast<size_t>(argument)];
+    return Result(code, argument, _token, a._display, text, a._position);
+  }
+
+  const StaticArgument (&_args)[N];
+  std::array<int, _table_size> _table{};
+  std::array<int, 256> _short{};
+  std::array<int, N> _positional{};
+  size_t _positional_count{0};
+  int _last{-1};
+  int _duplicate{-1};
+  std::bitset<N> _required{};
+  std::bitset<N> _found{};
+  std::array<slot, N> _slots{};
+  const char **_argv{nullptr};
+  int _current{-1};
+  int _token{-1};
+};
 
 }  // namespace argparse
 #endif
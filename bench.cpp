@@ -0,0 +1,343 @@
+/**
+ * License: Apache 2.0 with LLVM Exception or GPL v3
+ *
+ * Author: Jesse Laning
+ */
+
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "argparse.h"
+
+using namespace argparse;
+
+using bench_clock = std::chrono::steady_clock;
+
+// every allocation made by the process goes through here so each benchmark
+// can report how much parsing allocated
+static size_t allocations = 0;
+static size_t allocated_bytes = 0;
+
+void *operator new(std::size_t n) {
+  ++allocations;
+  allocated_bytes += n;
+  void *p = std::malloc(n ? n : 1);
+  if (!p) {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+void operator delete(void *p) noexcept { std::free(p); }
+
+static volatile size_t sink = 0;
+
+static double elapsed_ns(bench_clock::time_point start) {
+  return static_cast<double>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(bench_clock::now() -
+                                                           start)
+          .count());
+}
+
+static std::vector<std::string> option_names(size_t count) {
+  std::vector<std::string> names;
+  for (size_t i = 0; i < count; ++i) {
+    names.push_back("--option-" + std::to_string(i));
+  }
+  return names;
+}
+
+// cost of exists() against the cost of the std::map lookup it replaced
+static void bench_name_lookup() {
+  const size_t lookups = 1000000;
+  std::cout << "name lookup" << std::endl;
+  std::cout << std::setw(10) << "options" << std::setw(16) << "exists() ns"
+            << std::setw(16) << "std::map ns" << std::endl;
+  const size_t counts[] = {5, 50, 500, 5000};
+  for (size_t count : counts) {
+    std::vector<std::string> names = option_names(count);
+    std::vector<const char *> argv{"bench"};
+    ArgumentParser parser("bench", "bench");
+    std::map<std::string, int> map;
+    for (size_t i = 0; i < count; ++i) {
+      parser.add_argument(names[i], "option");
+      map[names[i].substr(2)] = static_cast<int>(i);
+      argv.push_back(names[i].c_str());
+    }
+    parser.parse(static_cast<int>(argv.size()), argv.data());
+
+    auto start = bench_clock::now();
+    for (size_t i = 0; i < lookups; ++i) {
+      sink = sink + parser.exists(names[i % count]);
+    }
+    double index_ns = elapsed_ns(start) / static_cast<double>(lookups);
+
+    start = bench_clock::now();
+    for (size_t i = 0; i < lookups; ++i) {
+      std::string n = names[i % count].substr(2);
+      sink = sink + static_cast<size_t>(map.find(n)->second);
+    }
+    double map_ns = elapsed_ns(start) / static_cast<double>(lookups);
+
+    std::cout << std::setw(10) << count << std::setw(16) << std::fixed
+              << std::setprecision(1) << index_ns << std::setw(16) << map_ns
+              << std::endl;
+  }
+  std::cout << std::endl;
+}
+
+// A command line to parse and the schema to parse it with. The measured work
+// runs on a freshly set up parser each repetition, enough repetitions are run
+// to cover at least 200,000 tokens.
+struct scenario {
+  std::string name;
+  std::vector<std::string> tokens;
+  std::function<void(ArgumentParser &)> setup;
+  std::function<void(ArgumentParser &)> after;
+};
+
+static void run(const scenario &s) {
+  std::vector<const char *> argv{"bench"};
+  for (auto &t : s.tokens) {
+    argv.push_back(t.c_str());
+  }
+  size_t tokens = s.tokens.size();
+  size_t reps = std::max<size_t>(1, 200000 / std::max<size_t>(tokens, 1));
+  double ns = 0;
+  size_t allocs = 0;
+  size_t bytes = 0;
+  for (size_t r = 0; r < reps; ++r) {
+    ArgumentParser parser("bench", "bench");
+    s.setup(parser);
+    size_t a = allocations;
+    size_t b = allocated_bytes;
+    auto start = bench_clock::now();
+    auto err = parser.parse(static_cast<int>(argv.size()), argv.data());
+    if (s.after) {
+      s.after(parser);
+    }
+    ns += elapsed_ns(start);
+    allocs += allocations - a;
+    bytes += allocated_bytes - b;
+    if (err) {
+      std::cout << s.name << ": " << err << std::endl;
+      return;
+    }
+  }
+  double per = static_cast<double>(tokens * reps);
+  std::cout << std::setw(24) << std::left << s.name << std::right
+            << std::setw(10) << tokens << std::setw(12) << std::fixed
+            << std::setprecision(1) << ns / per << std::setw(14)
+            << std::setprecision(3) << static_cast<double>(allocs) / per
+            << std::setw(14) << std::setprecision(1)
+            << static_cast<double>(bytes) / per << std::endl;
+}
+
+static void bench_parse() {
+  std::cout << std::setw(24) << std::left << "parse" << std::right
+            << std::setw(10) << "tokens" << std::setw(12) << "ns/token"
+            << std::setw(14) << "allocs/token" << std::setw(14)
+            << "bytes/token" << std::endl;
+
+  const size_t sizes[] = {10, 100, 1000, 10000, 100000, 1000000};
+  const std::vector<std::string> names = option_names(50);
+
+  // --option-N value pairs over 50 options
+  for (size_t n : sizes) {
+    scenario s{"long options", {}, [&](ArgumentParser &p) {
+                 // options come round again, and their values are ignored
+                 p.enable_free_values();
+                 for (auto &name : names) {
+                   p.add_argument(name, "option").count(1);
+                 }
+               },
+               nullptr};
+    for (size_t i = 0; i < n / 2; ++i) {
+      s.tokens.push_back(names[i % names.size()]);
+      s.tokens.push_back(std::to_string(i));
+    }
+    run(s);
+  }
+
+  // the same 10,000 tokens against a growing option set
+  const size_t option_counts[] = {5, 50, 500, 5000};
+  for (size_t count : option_counts) {
+    std::vector<std::string> options = option_names(count);
+    scenario s{"options " + std::to_string(count), {},
+               [&](ArgumentParser &p) {
+                 for (auto &name : options) {
+                   p.add_argument(name, "option").count(0);
+                 }
+               },
+               nullptr};
+    for (size_t i = 0; i < 10000; ++i) {
+      s.tokens.push_back(options[(i * 7919) % count]);
+    }
+    run(s);
+  }
+
+  // -abcdefgh clusters
+  for (size_t n : sizes) {
+    scenario s{"short clusters", {}, [](ArgumentParser &p) {
+                 for (char c = 'a'; c <= 'h'; ++c) {
+                   p.add_argument(std::string("-") + c, "flag").count(0);
+                 }
+               },
+               nullptr};
+    s.tokens.assign(n, "-abcdefgh");
+    run(s);
+  }
+
+  // --option-N=value
+  for (size_t n : sizes) {
+    scenario s{"--name=value", {}, [&](ArgumentParser &p) {
+                 p.enable_free_values();
+                 for (auto &name : names) {
+                   p.add_argument(name, "option").count(1);
+                 }
+               },
+               nullptr};
+    for (size_t i = 0; i < n; ++i) {
+      s.tokens.push_back(names[i % names.size()] + "=" + std::to_string(i));
+    }
+    run(s);
+  }
+
+  // a file list given to one argument
+  for (size_t n : sizes) {
+    scenario s{"file list", {"--files"}, [](ArgumentParser &p) {
+                 p.add_argument("--files", "files");
+               },
+               nullptr};
+    for (size_t i = 1; i < n; ++i) {
+      s.tokens.push_back("/data/input/file-" + std::to_string(i) + ".dat");
+    }
+    run(s);
+  }
+
+  // every token is a positional argument
+  const size_t positional_counts[] = {10, 100, 1000};
+  for (size_t n : positional_counts) {
+    scenario s{"positionals", {}, [n](ArgumentParser &p) {
+                 for (size_t i = 0; i < n; ++i) {
+                   p.add_argument()
+                       .name("--p" + std::to_string(i))
+                       .position(static_cast<int>(i));
+                 }
+               },
+               nullptr};
+    for (size_t i = 0; i < n; ++i) {
+      s.tokens.push_back("file-" + std::to_string(i));
+    }
+    run(s);
+  }
+
+  // parse followed by converting a large vector
+  for (size_t n : sizes) {
+    scenario s{"get<vector<int>>", {"--values"},
+               [](ArgumentParser &p) { p.add_argument("--values", "values"); },
+               [](ArgumentParser &p) {
+                 sink = sink + p.get<std::vector<int>>("values").size();
+               }};
+    for (size_t i = 1; i < n; ++i) {
+      s.tokens.push_back(std::to_string(i));
+    }
+    run(s);
+  }
+
+  // parse followed by converting a large list of weights
+  for (size_t n : sizes) {
+    scenario s{"get<vector<double>>", {"--weights"},
+               [](ArgumentParser &p) { p.add_argument("--weights", "values"); },
+               [](ArgumentParser &p) {
+                 sink = sink + p.get<std::vector<double>>("weights").size();
+               }};
+    for (size_t i = 1; i < n; ++i) {
+      s.tokens.push_back(std::to_string(i % 1000) + "." +
+                         std::to_string(i % 997));
+    }
+    run(s);
+  }
+}
+
+// one compiled parser parsing the same short command line over and over
+static void bench_reparse() {
+  const size_t reps = 100000;
+  const std::vector<std::string> names = option_names(50);
+  ArgumentParser parser("bench", "bench");
+  for (auto &name : names) {
+    parser.add_argument(name, "option").count(1);
+  }
+  parser.compile();
+  std::vector<std::string> tokens;
+  for (size_t i = 0; i < 5; ++i) {
+    tokens.push_back(names[i * 7]);
+    tokens.push_back(std::to_string(i));
+  }
+  std::vector<const char *> argv{"bench"};
+  for (auto &t : tokens) {
+    argv.push_back(t.c_str());
+  }
+  parser.parse(static_cast<int>(argv.size()), argv.data());
+  size_t a = allocations;
+  size_t b = allocated_bytes;
+  auto start = bench_clock::now();
+  for (size_t r = 0; r < reps; ++r) {
+    parser.parse(static_cast<int>(argv.size()), argv.data());
+  }
+  double per = static_cast<double>(tokens.size() * reps);
+  std::cout << std::setw(24) << std::left << "reparse" << std::right
+            << std::setw(10) << tokens.size() << std::setw(12) << std::fixed
+            << std::setprecision(1) << elapsed_ns(start) / per
+            << std::setw(14) << std::setprecision(3)
+            << static_cast<double>(allocations - a) / per << std::setw(14)
+            << std::setprecision(1)
+            << static_cast<double>(allocated_bytes - b) / per << std::endl;
+}
+
+// cost of rejecting a mistyped option, and of the suggestion worked out
+// for it on request
+static void bench_suggestion() {
+  const size_t reps = 1000;
+  std::cout << std::endl << "unrecognized option" << std::endl;
+  std::cout << std::setw(10) << "options" << std::setw(16) << "reject ns"
+            << std::setw(16) << "suggest ns" << std::endl;
+  const size_t counts[] = {5, 50, 500, 5000};
+  for (size_t count : counts) {
+    std::vector<std::string> names = option_names(count);
+    ArgumentParser parser("bench", "bench");
+    for (auto &name : names) {
+      parser.add_argument(name, "option").count(0);
+    }
+    parser.compile();
+    const char *argv[] = {"bench", "--optoin-3"};
+    auto start = bench_clock::now();
+    for (size_t r = 0; r < reps; ++r) {
+      sink = sink + static_cast<size_t>(parser.parse(2, argv).code());
+    }
+    double reject_ns = elapsed_ns(start) / static_cast<double>(reps);
+    auto err = parser.parse(2, argv);
+    start = bench_clock::now();
+    for (size_t r = 0; r < reps; ++r) {
+      sink = sink + err.suggestion().size();
+    }
+    double suggest_ns = elapsed_ns(start) / static_cast<double>(reps);
+    std::cout << std::setw(10) << count << std::setw(16) << std::fixed
+              << std::setprecision(1) << reject_ns << std::setw(16)
+              << suggest_ns << std::endl;
+  }
+}
+
+int main() {
+  bench_name_lookup();
+  bench_parse();
+  bench_reparse();
+  bench_suggestion();
+}
@@ -0,0 +1,180 @@
+/**
+ * License: Apache 2.0 with LLVM Exception or GPL v3
+ *
+ * Author: Jesse Laning
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "argparse.h"
+
+using namespace argparse;
+
+using bench_clock = std::chrono::steady_clock;
+
+// Command lines are parsed at a base size and at 8 times that size. Linear
+// parsing takes about 8 times as long on the larger one, quadratic parsing
+// 64 times, so anything past the allowed ratio fails the case.
+static const size_t growth = 8;
+static const double allowed_ratio = 20.0;
+
+// An adversarial command line of a given size and the schema it is parsed
+// with. check runs after the parse, on its result, and is timed with it.
+struct adversary {
+  std::string name;
+  std::function<void(ArgumentParser &)> setup;
+  std::function<std::vector<std::string>(size_t)> tokens;
+  size_t size;
+  std::function<void(const ArgumentParser::Result &)> check;
+};
+
+static volatile size_t sink = 0;
+
+static double parse_ns(const adversary &a, size_t size) {
+  std::vector<std::string> tokens = a.tokens(size);
+  std::vector<const char *> argv{"complexity"};
+  for (auto &t : tokens) {
+    argv.push_back(t.c_str());
+  }
+  double best = 0;
+  for (int r = 0; r < 5; ++r) {
+    ArgumentParser parser("complexity", "complexity");
+    a.setup(parser);
+    parser.compile();
+    auto start = bench_clock::now();
+    auto err = parser.parse(static_cast<int>(argv.size()), argv.data());
+    if (a.check) {
+      a.check(err);
+    }
+    double ns = static_cast<double>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            bench_clock::now() - start)
+            .count());
+    best = r == 0 ? ns : std::min(best, ns);
+  }
+  return std::max(best, 1.0);
+}
+
+static std::vector<std::string> repeat(const std::string &token, size_t n) {
+  return std::vector<std::string>(n, token);
+}
+
+static void flags(ArgumentParser &p) {
+  for (char c = 'a'; c <= 'z'; ++c) {
+    p.add_argument(std::string("-") + c, "flag").count(0);
+  }
+}
+
+static void options(ArgumentParser &p) {
+  // values past an option's count are let through, so the overflow cases
+  // run to the end of the command line
+  p.enable_free_values();
+  p.add_argument("-j", "--jobs", "option", false).count(1);
+  p.add_argument("-o", "--output", "option", false).count(2);
+  p.add_argument("--files", "option");
+  p.add_argument().name("--first").position(1);
+  for (int i = 0; i < 100; ++i) {
+    p.add_argument("--" + std::string(200, 'x') + std::to_string(i), "option")
+        .count(0);
+  }
+}
+
+int main() {
+  std::vector<adversary> cases{
+      {"one huge flag cluster", flags,
+       [](size_t n) {
+         std::string cluster = "-";
+         for (size_t i = 0; i < n; ++i) {
+           cluster += static_cast<char>('a' + i % 26);
+         }
+         return std::vector<std::string>{cluster};
+       },
+       200000, nullptr},
+      {"many flag clusters", flags,
+       [](size_t n) { return repeat("-abcdefghijklmnopqrstuvwxyz", n); },
+       20000, nullptr},
+      {"huge attached value", options,
+       [](size_t n) {
+         return std::vector<std::string>{"-j" + std::string(n, '7')};
+       },
+       1000000, nullptr},
+      {"name=value forms", options,
+       [](size_t n) { return repeat("--jobs=4", n); }, 50000, nullptr},
+      {"values full of =", options,
+       [](size_t n) { return repeat("--files=" + std::string(64, '='), n); },
+       20000, nullptr},
+      {"count overflow", options,
+       [](size_t n) {
+         std::vector<std::string> t{"--output"};
+         for (size_t i = 0; i < n; ++i) {
+           t.push_back("value");
+         }
+         return t;
+       },
+       50000, nullptr},
+      {"alternating overflow", options,
+       [](size_t n) {
+         std::vector<std::string> t;
+         for (size_t i = 0; i < n; ++i) {
+           t.push_back("-j");
+           t.push_back("1");
+           t.push_back("2");
+         }
+         return t;
+       },
+       20000, nullptr},
+      {"greedy value list", options,
+       [](size_t n) {
+         std::vector<std::string> t{"--files"};
+         for (size_t i = 0; i < n; ++i) {
+           t.push_back("file");
+         }
+         return t;
+       },
+       50000, nullptr},
+      {"long unknown name",
+       options,
+       [](size_t n) {
+         return std::vector<std::string>{"--" + std::string(n, 'x')};
+       },
+       200000,
+       [](const ArgumentParser::Result &err) {
+         sink = sink + err.what().size();
+       }},
+      {"long option names", options,
+       [](size_t n) {
+         std::vector<std::string> t;
+         for (size_t i = 0; i < n; ++i) {
+           t.push_back("--" + std::string(200, 'x') +
+                       std::to_string(i % 100));
+         }
+         return t;
+       },
+       5000, nullptr},
+  };
+
+  std::cout << std::setw(24) << std::left << "case" << std::right
+            << std::setw(12) << "size" << std::setw(14) << "ms"
+            << std::setw(14) << "ms at x8" << std::setw(10) << "ratio"
+            << std::endl;
+  int failures = 0;
+  for (auto &a : cases) {
+    double small = parse_ns(a, a.size);
+    double large = parse_ns(a, a.size * growth);
+    double ratio = large / small;
+    bool pass = ratio <= allowed_ratio;
+    failures += !pass;
+    std::cout << std::setw(24) << std::left << a.name << std::right
+              << std::setw(12) << a.size << std::setw(14) << std::fixed
+              << std::setprecision(3) << small / 1e6 << std::setw(14)
+              << large / 1e6 << std::setw(10) << std::setprecision(1)
+              << ratio << (pass ? "" : "  super-linear") << std::endl;
+  }
+  return failures;
+}
@@ -4,16 +4,39 @@
  * Author: Jesse Laning
  */
 
+#include <atomic>
+#include <clocale>
 #include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
 #include <functional>
 #include <iostream>
+#include <new>
+#include <sstream>
 #include <string>
+#include <thread>
 #include <unordered_map>
 
 #include "argparse.h"
 
 using namespace argparse;
 
+// every allocation made by the process goes through here so tests can hold
+// parsing to an allocation budget
+static std::atomic<size_t> allocations{0};
+
+void* operator new(std::size_t n) {
+  ++allocations;
+  void* p = std::malloc(n ? n : 1);
+  if (!p) {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+
 struct result {
   bool pass;
   int line;
@@ -261,6 +284,7 @@ TEST(
       // This test should pass because it will treat the last argument as a
       // free/positional argument
       size_t c = 4;
+      parser.enable_free_values();
       parser.add_argument("-f", "--flag", "a flag", true)
           .count(static_cast<int>(c));
 
@@ -292,6 +316,7 @@ TEST(
 TEST(
     arg_count_zero,
     {
+      parser.enable_free_values();
       parser.add_argument("-f", "--flag", "a flag", true).count(0);
       parser.add_argument("-b", "--bbbb", "a flag", true).count(0);
       parser.add_argument("-c", "--cccc", "a flag", true).count(0);
@@ -308,9 +333,41 @@ TEST(
     },
     "-f", "a", "b", "1", "-b", "a", "-c")
 
+static const char* free_argv[] = {"free", "-f", "1", "2"};
+static const char* repeat_argv[] = {"free", "-f", "1", "-f", "2", "-v"};
+
+TEST(
+    free_values,
+    {
+      parser.add_argument("-f", "--flag", "a flag", true).count(1);
+      parser.add_argument("-v", "--verbose", "a flag", false).count(0);
+
+      auto err = parser.parse(4, free_argv);
+      TASSERT(err.code() == ArgumentParser::Result::UNKNOWN_ARGUMENT &&
+                  err.token() == 3,
+              "value past the count dropped")
+      TASSERT(err.what() == std::string("Unknown argument: 2"), err.what())
+      err = parser.parse(argc, argv);
+      TASSERT(err.code() == ArgumentParser::Result::TOO_MANY_VALUES,
+              "value given to a flag dropped")
+      TASSERT(err.what() == std::string("Too many arguments given for -v"),
+              err.what())
+      err = parser.parse(6, repeat_argv);
+      TASSERT(err.code() == ArgumentParser::Result::TOO_MANY_VALUES &&
+                  err.token() == 4,
+              "value of a repeated option dropped")
+
+      parser.enable_free_values();
+      err = parser.parse(4, free_argv);
+      TASSERT(!err, err.what())
+      TASSERT(parser.get<int>("f") == 1, "wrong flag value")
+    },
+    "-f", "1", "--verbose=yes")
+
 TEST(
     positional_argument_found,
     {
+      parser.enable_free_values();
       parser.add_argument("-f", "--flag", "a flag", true).count(0);
       parser.add_argument().name("--file").position(3);
 
@@ -347,6 +404,7 @@ TEST(
 TEST(
     positional_argument_last,
     {
+      parser.enable_free_values();
       parser.add_argument("-f", "--flag", "a flag", true).count(1);
       parser.add_argument()
           .name("--file")
@@ -378,6 +436,1257 @@ TEST(
     },
     "-f", "1", "2", "myfile", "asdf")
 
+TEST(
+    zero_copy_values,
+    {
+      parser.enable_zero_copy();
+      parser.add_argument("-f", "--files", "files", true);
+
+      auto err = parser.parse(argc, argv);
+      TASSERT(!err, err.what())
+
+      auto& values = parser.values("files");
+      TASSERT(values.size() == 2, "wrong vector values")
+      TASSERT(values[0].data() == argv[2] && values[1].data() == argv[3],
+              "values were copied")
+      TASSERT(values[1] == "b.txt", "wrong vector values")
+    },
+    "-f", "a.txt", "b.txt")
+
+TEST(
+    many_options,
+    {
+      for (int i = 0; i < 100; ++i) {
+        parser.add_argument("--option" + std::to_string(i), "an option");
+      }
+
+      auto err = parser.parse(argc, argv);
+      TASSERT(!err, err.what())
+
+      TASSERT(parser.exists("option7"), "option7 not found")
+      TASSERT(parser.exists("--option99"), "option99 not found")
+      TASSERT(!parser.exists("option50"), "option50 found")
+      TASSERT(!parser.exists("option100"), "option100 found")
+    },
+    "--option7", "--option99")
+
+TEST(
+    duplicate_name,
+    {
+      parser.add_argument("-f", "--flag", "a flag", false);
+      parser.add_argument("--flag", "another flag");
+
+      auto err = parser.parse(argc, argv);
+      TASSERT(err, "duplicate name accepted")
+      TASSERT(parser.help() == err.what() + "\n", "help of a broken parser")
+    },
+    "--flag")
+
+static constexpr StaticArgument static_args[] = {
+    {"-v", "--verbose"},
+    {"-o", "--output", true, 1},
+    {"", "--file", false, ArgumentParser::Argument::Count::ANY,
+     ArgumentParser::Argument::Position::LAST}};
+
+TEST(
+    static_parser,
+    {
+      StaticArgumentParser<3> sparser(static_args);
+      auto err = sparser.parse(argc, argv);
+      TASSERT(!err, err.what())
+
+      TASSERT(sparser.exists("v"), "flag not found")
+      TASSERT(sparser.get<std::vector<int>>("verbose").size() == 2,
+              "wrong vector values")
+      TASSERT(sparser.get<int>("v") == 1, "wrong flag value")
+      TASSERT(sparser.value("output") == "out.txt", "wrong flag value")
+      TASSERT(sparser.value("file") == "last", "Positional argument error")
+    },
+    "-v", "1", "2", "--output=out.txt", "last")
+
+TEST(
+    static_parser_required, {
+      StaticArgumentParser<3> sparser(static_args);
+      auto err = sparser.parse(argc, argv);
+      TASSERT(err, "missing required argument accepted")
+    }, )
+
+TEST(
+    typed_conversion,
+    {
+      parser.add_argument("-x", "--hex", "a flag", false).count(1);
+      parser.add_argument("-o", "--oct", "a flag", false).count(1);
+      parser.add_argument("-s", "--sep", "a flag", false).count(1);
+      parser.add_argument("-n", "--neg", "a flag", false).count(1);
+      parser.add_argument("-d", "--dbl", "a flag", false).count(1);
+
+      auto err = parser.parse(argc, argv);
+      TASSERT(!err, err.what())
+
+      TASSERT(parser.get<int>("hex") == 255, "wrong hex value")
+      TASSERT(parser.get<unsigned>("oct") == 8, "wrong octal value")
+      TASSERT(parser.get<long>("sep") == 1000000, "wrong separated value")
+      TASSERT(parser.get<char>("neg") == '-',
+              "character types should read a single character")
+      TASSERT(parser.get<int>("neg") == -128, "wrong negative value")
+      TASSERT(std::abs(parser.get<double>("dbl") - 1000.5) < 0.0000000001,
+              "wrong floating point value")
+    },
+    "-x", "0xff", "-o", "0o10", "-s", "1_000_000", "-n", "-128", "-d",
+    "1_000.5")
+
+TEST(
+    checked_conversion,
+    {
+      parser.add_argument("-b", "--byte", "a flag", false).count(1);
+      parser.add_argument("-g", "--garbage", "a flag", false).count(1);
+      parser.add_argument("-v", "--vector", "a flag", false);
+      parser.add_argument("-e", "--exponent", "a flag", false).count(1);
+      parser.add_argument("-s", "--suffix", "a flag", false).count(1);
+      parser.add_argument("-x", "--hex", "a flag", false).count(1);
+
+      auto err = parser.parse(argc, argv);
+      TASSERT(!err, err.what())
+
+      TASSERT(!parser.convert<double>("exponent").ok(),
+              "separator before an exponent accepted")
+      TASSERT(!parser.convert<float>("suffix").ok(),
+              "separator before a letter accepted")
+      TASSERT(std::abs(parser.convert<double>("hex").value() - 31) <
+                  0.0000000001,
+              "separator in a hexadecimal float rejected")
+      TASSERT(!parser.convert<int8_t>("byte").ok(), "overflow not detected")
+      TASSERT(parser.convert<int16_t>("byte").value() == 128, "wrong value")
+      TASSERT(!parser.convert<int>("garbage").ok(), "garbage accepted")
+      TASSERT(parser.get<int>("garbage") == 0, "garbage accepted")
+      TASSERT(!parser.convert<std::vector<int>>("vector").ok(),
+              "garbage accepted")
+      auto v = parser.get<std::vector<int>>("vector");
+      TASSERT(v.size() == 3 && v[0] == 1 && v[1] == 0 && v[2] == 3,
+              "wrong vector values")
+    },
+    "-b", "128", "-g", "12abc", "-e", "1_e5", "-s", "1_f", "-x", "0x1_f",
+    "-v", "1", "x", "3")
+
+// switches to a locale with a decimal comma, when the system has one
+static void use_comma_locale() {
+  for (const char* name : {"de_DE.UTF-8", "de_DE.utf8", "de_DE", "fr_FR.UTF-8",
+                           "fr_FR.utf8", "fr_FR"}) {
+    if (std::setlocale(LC_NUMERIC, name)) {
+      return;
+    }
+  }
+}
+
+TEST(
+    locale_independent_conversion,
+    {
+      parser.add_argument("-d", "--dot", "a flag", false).count(1);
+      parser.add_argument("-c", "--comma", "a flag", false).count(1);
+
+      auto err = parser.parse(argc, argv);
+      TASSERT(!err, err.what())
+
+      use_comma_locale();
+      auto dot = parser.convert<double>("dot");
+      auto small = parser.convert<float>("dot");
+      auto wide = parser.convert<long double>("dot");
+      bool rejected = !parser.convert<double>("comma").ok();
+      std::setlocale(LC_NUMERIC, "C");
+
+      TASSERT(dot.ok() && std::abs(dot.value() - 12.5) < 0.0000000001,
+              "decimal point read through the locale")
+      TASSERT(small.ok() && std::abs(small.value() - 12.5f) < 0.0001f,
+              "decimal point read through the locale")
+      TASSERT(wide.ok() && std::abs(wide.value() - 12.5L) < 0.0000000001L,
+              "decimal point read through the locale")
+      TASSERT(rejected, "decimal comma accepted")
+    },
+    "-d", "1.25e1", "-c", "1,25e1")
+
+TEST(
+    cached_values,
+    {
+      parser.add_argument("-t", "--threads", "a flag", false).type<int>();
+      parser.add_argument("-w", "--weights", "a flag", false);
+
+      auto err = parser.parse(argc, argv);
+      TASSERT(!err, err.what())
+
+      TASSERT(parser.get<int>("threads") == 8, "wrong flag value")
+      TASSERT(parser.get<int>("threads") == 8, "wrong cached value")
+      TASSERT(parser.get<std::string>("threads") == "8", "wrong string value")
+      TASSERT(parser.get<std::vector<int>>("weights").size() == 2,
+              "wrong vector values")
+      TASSERT(parser.get<std::vector<double>>("weights").size() == 2,
+              "wrong vector values")
+    },
+    "-t", "8", "-w", "1", "2")
+
+TEST(
+    dashed_names,
+    {
+      parser.add_argument("--dry-run", "a flag", false).count(0);
+      parser.add_argument("--max_jobs", "a flag", false).count(1);
+
+      auto err = parser.parse(argc, argv);
+      TASSERT(!err, err.what())
+
+      TASSERT(parser.exists("dry-run"), "flag not found")
+      TASSERT(parser.get<int>("max_jobs") == 4, "wrong flag value")
+    },
+    "--dry-run", "--max_jobs=4")
+
+static const char* reuse_argv[] = {"reuse", "-t", "4", "--verbose"};
+
+TEST(
+    reuse_parser,
+    {
+      parser.add_argument("-t", "--threads", "a flag", false).count(1);
+      parser.add_argument("-v", "--verbose", "a flag", false).count(0);
+      auto err = parser.compile();
+      TASSERT(!err, err.what())
+
+      err = parser.parse(argc, argv);
+      TASSERT(!err, err.what())
+      TASSERT(parser.get<int>("threads") == 8, "wrong flag value")
+      TASSERT(!parser.exists("verbose"), "flag found")
+
+      for (int i = 0; i < 3; ++i) {
+        err = parser.parse(4, reuse_argv);
+        TASSERT(!err, err.what())
+        TASSERT(parser.get<int>("threads") == 4, "stale flag value")
+        TASSERT(parser.values("threads").size() == 1, "values accumulated")
+        TASSERT(parser.exists("verbose"), "flag not found")
+      }
+
+      err = parser.parse(1, argv);
+      TASSERT(!err, err.what())
+      TASSERT(!parser.exists("threads"), "stale flag found")
+    },
+    "-t", "8")
+
+static const char* thread_argv[][3] = {{"threads", "-t", "0"},
+                                       {"threads", "-t", "1"},
+                                       {"threads", "-t", "2"},
+                                       {"threads", "-t", "3"}};
+
+static void parse_on_thread(const ArgumentParser& parser, int t, char* ok) {
+  ArgumentParser::ParseResult r;
+  bool all = true;
+  for (int i = 0; i < 1000; ++i) {
+    auto err = parser.parse(3, thread_argv[t], r);
+    all = all && !err && r.get<int>("thread") == t;
+  }
+  *ok = all;
+}
+
+TEST(
+    concurrent_parse_results,
+    {
+      parser.add_argument("-t", "--thread", "a flag", true).count(1);
+      auto err = parser.compile();
+      TASSERT(!err, err.what())
+
+      std::vector<char> ok(4);
+      std::vector<std::thread> threads;
+      for (int t = 0; t < 4; ++t) {
+        threads.emplace_back(parse_on_thread, std::cref(parser), t,
+                             &ok[static_cast<size_t>(t)]);
+      }
+      for (auto& t : threads) {
+        t.join();
+      }
+      TASSERT(ok[0] && ok[1] && ok[2] && ok[3], "wrong parse result")
+      TASSERT(!parser.exists("thread"), "parser state modified")
+    }, )
+
+static void get_on_thread(const ArgumentParser& parser, char* ok) {
+  bool all = true;
+  for (int i = 0; i < 1000; ++i) {
+    all = all && parser.get<int>("threads") == 8 &&
+          parser.ref<std::string>("threads") == "8" &&
+          parser.get<std::vector<int>>("threads").size() == 1;
+  }
+  *ok = all;
+}
+
+TEST(
+    concurrent_get,
+    {
+      parser.add_argument("-t", "--threads", "a flag", true).count(1);
+      auto err = parser.parse(argc, argv);
+      TASSERT(!err, err.what())
+
+      std::vector<char> ok(4);
+      std::vector<std::thread> threads;
+      for (size_t t = 0; t < 4; ++t) {
+        threads.emplace_back(get_on_thread, std::cref(parser), &ok[t]);
+      }
+      for (auto& t : threads) {
+        t.join();
+      }
+      TASSERT(ok[0] && ok[1] && ok[2] && ok[3], "wrong cached value")
+    },
+    "-t", "8")
+
+TEST(
+    batch_parse,
+    {
+      parser.add_argument("-t", "--threads", "a flag", true).count(1);
+      auto err = parser.compile();
+      TASSERT(!err, err.what())
+
+      std::vector<std::vector<std::string>> lines;
+      for (int i = 0; i < 1000; ++i) {
+        if (i % 10 == 3) {
+          lines.push_back(std::vector<std::string>(1, "batch"));
+        } else {
+          lines.push_back(std::vector<std::string>(1, "batch"));
+          lines.back().push_back("-t");
+          lines.back().push_back(std::to_string(i));
+        }
+      }
+      std::vector<ArgumentParser::ParseResult> results;
+      auto errors = parser.parse_batch(lines, results, 4);
+      TASSERT(errors.size() == lines.size() && results.size() == lines.size(),
+              "wrong batch size")
+      for (int i = 0; i < 1000; ++i) {
+        size_t n = static_cast<size_t>(i);
+        if (i % 10 == 3) {
+          TASSERT(errors[n], "missing required argument accepted")
+        } else {
+          TASSERT(!errors[n], errors[n].what())
+          TASSERT(results[n].get<int>("threads") == i, "wrong flag value")
+        }
+      }
+    }, )
+
+// A file a test reads, removed again when the test returns
+class scratch_file {
+ public:
+  scratch_file(const char* path, const char* contents) : _path(path) {
+    write(contents);
+  }
+  scratch_file(const scratch_file&) = delete;
+  scratch_file& operator=(const scratch_file&) = delete;
+  ~scratch_file() { std::remove(_path); }
+
+  void write(const char* contents) {
+    std::ofstream out(_path, std::ios::binary);
+    out << contents;
+  }
+
+ private:
+  const char* _path;
+};
+
+TEST(
+    response_file,
+    {
+      scratch_file outer("argparse_outer.rsp",
+                         "-t 4 --name 'two words' \"quoted \\\"inner\\\"\"\n"
+                         "  @argparse_inner.rsp\n");
+      scratch_file inner("argparse_inner.rsp", "--files a\\ b c\n");
+      parser.add_argument("-t", "--threads", "a flag", false).count(1);
+      parser.add_argument("-n", "--name", "a flag", false).count(2);
+      parser.add_argument("-f", "--files", "a flag", false);
+      parser.add_argument().name("last").position(
+          ArgumentParser::Argument::Position::LAST);
+      parser.enable_response_files();
+
+      auto err = parser.parse(argc, argv);
+      TASSERT(!err, err.what())
+      TASSERT(parser.get<int>("threads") == 4, "wrong flag value")
+      auto name = parser.values("name");
+      TASSERT(name.size() == 2 && name[0] == "two words" &&
+                  name[1] == "quoted \"inner\"",
+              "quotes not removed")
+      auto files = parser.values("files");
+      TASSERT(files.size() == 2 && files[0] == "a b" && files[1] == "c",
+              "escape not removed")
+      TASSERT(parser.get<std::string>("last") == "end", "wrong last value")
+    },
+    "@argparse_outer.rsp", "end")
+
+static const char* missing_argv[] = {"missing", "@argparse_missing.rsp"};
+
+TEST(
+    response_file_cycle,
+    {
+      scratch_file cycle("argparse_cycle.rsp", "-v @argparse_cycle.rsp");
+      parser.add_argument("-v", "--verbose", "a flag", false).count(0);
+      parser.enable_response_files();
+
+      auto err = parser.parse(argc, argv);
+      TASSERT(err && std::string(err.what()).find("includes itself") !=
+                         std::string::npos,
+              "cycle not detected")
+      err = parser.parse(2, missing_argv);
+      TASSERT(err && std::string(err.what()).find("Unable to read") !=
+                         std::string::npos,
+              "missing file not reported")
+    },
+    "@argparse_cycle.rsp")
+
+TEST(
+    stream_parse,
+    {
+      parser.add_argument("-t", "--threads", "a flag", false).count(1);
+      parser.add_argument("-v", "--verbose", "a flag", false).count(0);
+      parser.add_argument("-f", "--files", "a flag", false);
+      auto err = parser.compile();
+      TASSERT(!err, err.what())
+
+      std::vector<std::string> done;
+      ArgumentParser::ParseResult r;
+      err = parser.begin(r, [&done](const ArgumentParser::ParsedArgument& a) {
+        done.push_back(a.name());
+      });
+      TASSERT(!err, err.what())
+
+      std::string token = "--threads";
+      TASSERT(!parser.feed(r, token), "feed failed")
+      token = "4";
+      TASSERT(!parser.feed(r, token), "feed failed")
+      TASSERT(done.size() == 1 && done[0] == "-t", "option not completed")
+      token = "-v";
+      TASSERT(!parser.feed(r, token), "feed failed")
+      TASSERT(done.size() == 2 && done[1] == "-v", "flag not completed")
+      token = "--files";
+      TASSERT(!parser.feed(r, token), "feed failed")
+      token = "a";
+      TASSERT(!parser.feed(r, token), "feed failed")
+      token = "b";
+      TASSERT(!parser.feed(r, token), "feed failed")
+      TASSERT(done.size() == 2, "list completed early")
+      token = "overwritten";
+
+      err = parser.finish(r);
+      TASSERT(!err, err.what())
+      TASSERT(done.size() == 3 && done[2] == "-f", "list not completed")
+      TASSERT(r.get<int>("threads") == 4, "wrong flag value")
+      TASSERT(r.exists("verbose"), "flag not found")
+      auto files = r.values("files");
+      TASSERT(files.size() == 2 && files[0] == "a" && files[1] == "b",
+              "fed tokens not kept")
+    }, )
+
+TEST(
+    stream_not_begun,
+    {
+      parser.add_argument("-t", "--threads", "a flag", false).count(1);
+      auto err = parser.compile();
+      TASSERT(!err, err.what())
+      ArgumentParser other("other", "other");
+      err = other.compile();
+      TASSERT(!err, err.what())
+
+      auto not_begun = [](const ArgumentParser::Result& e) {
+        return e.code() == ArgumentParser::Result::NOT_BEGUN;
+      };
+      ArgumentParser::ParseResult r;
+      TASSERT(not_begun(parser.feed(r, "-t")), "fresh result fed")
+      TASSERT(not_begun(parser.finish(r)), "fresh result finished")
+
+      TASSERT(!other.begin(r), "begin failed")
+      TASSERT(not_begun(parser.feed(r, "-t")),
+              "result begun by another parser fed")
+
+      TASSERT(!parser.begin(r), "begin failed")
+      r.reset();
+      TASSERT(not_begun(parser.feed(r, "-t")), "reset result fed")
+
+      TASSERT(!parser.begin(r), "begin failed")
+      TASSERT(!parser.feed(r, "-t") && !parser.feed(r, "4"), "feed failed")
+      err = parser.finish(r);
+      TASSERT(!err, err.what())
+      TASSERT(not_begun(parser.feed(r, "-t")), "finished result fed")
+      TASSERT(r.get<int>("threads") == 4, "finished result changed")
+    }, )
+
+static const char* bad_bind_argv[] = {"bind", "-t", "abc"};
+static const char* huge_bind_argv[] = {"bind", "-t", "99999999999"};
+static const char* bad_long_bind_argv[] = {"bind", "--threads=abc"};
+static const char* bad_attached_bind_argv[] = {"bind", "-tabc"};
+static const char* other_bind_argv[] = {"bind", "-t", "7"};
+
+TEST(
+    bind_and_action,
+    {
+      int threads = 0;
+      bool verbose = false;
+      bool quiet = false;
+      std::vector<double> weights;
+      std::string name;
+      int actions = 0;
+      parser.add_argument("-t", "--threads", "a flag", false)
+          .count(1)
+          .bind(threads);
+      parser.add_argument("-v", "--verbose", "a flag", false)
+          .count(0)
+          .bind(verbose);
+      parser.add_argument("-q", "--quiet", "a flag", false)
+          .count(0)
+          .bind(quiet);
+      parser.add_argument("-w", "--weights", "a flag", false).bind(weights);
+      parser.add_argument("-n", "--name", "a flag", false)
+          .count(1)
+          .bind(name)
+          .action([&actions](const ArgumentParser::ParsedArgument& a) {
+            actions += a.found();
+          });
+
+      auto err = parser.parse(argc, argv);
+      TASSERT(!err, err.what())
+      TASSERT(threads == 4, "wrong bound value")
+      TASSERT(verbose && !quiet, "wrong bound flag")
+      TASSERT(weights.size() == 2 &&
+                  std::abs(weights[0] - 1.5) < 0.0000000001 &&
+                  std::abs(weights[1] - 2.5) < 0.0000000001,
+              "wrong bound list")
+      TASSERT(name == "x", "wrong bound string")
+      TASSERT(actions == 1, "action not called once")
+
+      err = parser.parse(3, bad_bind_argv);
+      TASSERT(err.code() == ArgumentParser::Result::INVALID_VALUE,
+              "malformed bound value accepted")
+      TASSERT(threads == 4, "target changed by a malformed value")
+      err = parser.parse(3, huge_bind_argv);
+      TASSERT(err.code() == ArgumentParser::Result::VALUE_OUT_OF_RANGE,
+              "out of range bound value accepted")
+      TASSERT(threads == 4, "target changed by an out of range value")
+      err = parser.parse(2, bad_long_bind_argv);
+      TASSERT(err.code() == ArgumentParser::Result::INVALID_VALUE,
+              "malformed --name=value bound value accepted")
+      err = parser.parse(2, bad_attached_bind_argv);
+      TASSERT(err.code() == ArgumentParser::Result::INVALID_VALUE,
+              "malformed attached bound value accepted")
+      TASSERT(threads == 4, "target changed by a malformed value")
+
+      ArgumentParser::ParseResult r;
+      err = parser.parse(3, other_bind_argv, r);
+      TASSERT(!err && r.get<int>("threads") == 7, err.what())
+      TASSERT(threads == 4 && actions == 1, "bind ran for a parse result")
+    },
+    "-t", "4", "-v", "--weights", "1.5", "2.5", "--name", "x")
+
+TEST(
+    arena_parse,
+    {
+      parser.add_argument("-t", "--threads", "a flag", false).count(1);
+      parser.add_argument("-f", "--files", "a flag", false);
+      auto err = parser.compile();
+      TASSERT(!err, err.what())
+
+      char buffer[1024];
+      Arena arena(buffer, sizeof(buffer));
+      ArgumentParser::ParseResult r(arena);
+      for (int i = 0; i < 3; ++i) {
+        err = parser.parse(argc, argv, r);
+        TASSERT(!err, err.what())
+        TASSERT(r.get<int>("threads") == 4, "wrong flag value")
+        auto& files = r.values("files");
+        TASSERT(files.size() == 3 && files[2] == "c", "wrong list value")
+        TASSERT(files.data() >= static_cast<void*>(buffer) &&
+                    files.data() < static_cast<void*>(buffer + sizeof(buffer)),
+                "values not in the arena")
+        TASSERT(files[0].data() >= buffer &&
+                    files[0].data() < buffer + sizeof(buffer),
+                "tokens not in the arena")
+      }
+
+      // once the buffer runs out the arena moves on to heap blocks
+      void* p = arena.allocate(2000);
+      TASSERT(p < static_cast<void*>(buffer) ||
+                  p >= static_cast<void*>(buffer + sizeof(buffer)),
+              "allocation past the end of the buffer")
+      arena.release();
+      TASSERT(arena.allocate(16) == static_cast<void*>(buffer),
+              "release did not rewind the arena")
+
+      // heap blocks an arena takes during a parse count as allocated
+      char small[16];
+      Arena growing(small, sizeof(small));
+      ArgumentParser::ParseResult g(growing);
+      ArgumentParser::ParseStats stats;
+      g.collect_stats(&stats);
+      err = parser.parse(argc, argv, g);
+      TASSERT(!err, err.what())
+      TASSERT(growing.reserved_bytes() >= 4096 &&
+                  stats.allocated_bytes >= 4096 &&
+                  stats.retained_bytes >= growing.reserved_bytes(),
+              "arena blocks not counted")
+      size_t allocated = stats.allocated_bytes;
+      err = parser.parse(argc, argv, g);
+      TASSERT(!err && stats.allocated_bytes == allocated,
+              "reused arena blocks counted again")
+    },
+    "-t", "4", "--files", "a", "b", "c")
+
+TEST(
+    help_text,
+    {
+      parser.add_argument("-v", "--verbose", "verbose level", true);
+      parser.add_argument("-o", "--output",
+                          "where the results of the run are written, one "
+                          "file per input, named after the input file",
+                          false);
+
+      const std::string& text = parser.help(0, 0, 64);
+      TASSERT(text.find("Usage: help_text [options...]\n") == 0,
+              "wrong usage line")
+      TASSERT(text.find("    -v, --verbose          verbose level") !=
+                  std::string::npos,
+              "wrong argument line")
+      TASSERT(text.find("(Required)") != std::string::npos,
+              "required not shown")
+      size_t line = 0;
+      for (size_t i = 0; i <= text.size(); ++i) {
+        if (i == text.size() || text[i] == '\n') {
+          TASSERT(i - line <= 64, "line not wrapped")
+          line = i + 1;
+        }
+      }
+      TASSERT(text.find("\n                           ") !=
+                  std::string::npos,
+              "description not wrapped")
+      TASSERT(&parser.help(0, 0, 64) == &text, "help not cached")
+
+      std::ostringstream out;
+      parser.print_help(out, 0, 0, 64);
+      TASSERT(out.str() == text, "printed help differs")
+
+      parser.add_argument("-q", "--quiet", "quiet", false);
+      TASSERT(parser.help(0, 0, 64).find("--quiet") != std::string::npos,
+              "stale help")
+      TASSERT(parser.help(1, 1).find("--output") != std::string::npos &&
+                  parser.help(1, 1).find("--verbose") == std::string::npos,
+              "wrong help page")
+    }, )
+
+static const char* error_argv[] = {"errors", "-t", "x", "--bogus"};
+
+TEST(
+    error_codes,
+    {
+      parser.add_argument("-t", "--threads", "a flag", false).count(1);
+      parser.add_argument("-v", "--verbose", "a flag", true).count(0);
+
+      auto err = parser.parse(4, error_argv);
+      TASSERT(err.code() == ArgumentParser::Result::UNRECOGNIZED_OPTION,
+              "wrong error code")
+      TASSERT(err.token() == 3 && err.text() == "bogus", "wrong token")
+      TASSERT(err.what() == "Unrecognized command line option 'bogus'",
+              err.what())
+
+      err = parser.parse(3, error_argv);
+      TASSERT(err.code() == ArgumentParser::Result::REQUIRED_NOT_FOUND,
+              "wrong error code")
+      TASSERT(err.argument() == 1 && err.token() == -1, "wrong argument")
+      TASSERT(err.what() == "Required argument not found: -v", err.what())
+
+      auto c = parser.result().convert<int>("threads");
+      TASSERT(c.error().code() == ArgumentParser::Result::INVALID_VALUE,
+              "wrong conversion error code")
+      TASSERT(c.error().argument() == 0 && c.error().text() == "x",
+              "wrong conversion error")
+
+      err = parser.parse(argc, argv);
+      TASSERT(!err && err.code() == ArgumentParser::Result::OK, err.what())
+      TASSERT(err.what().empty(), "message on success")
+    },
+    "-v")
+
+// Error for a value that no longer exists, from a parser that no longer
+// exists either
+static ArgumentParser::Result orphaned_error() {
+  std::string value = "not a number";
+  const char* args[] = {"orphan", "-t", value.c_str()};
+  ArgumentParser parser("orphan", "orphan");
+  parser.add_argument("-t", "--threads", "a flag", false).count(1);
+  parser.parse(3, args);
+  return parser.convert<int>("threads").error();
+}
+
+static ArgumentParser::Result orphaned_typo() {
+  const char* args[] = {"orphan", "--thraeds"};
+  ArgumentParser parser("orphan", "orphan");
+  parser.add_argument("-t", "--threads", "a flag", false).count(1);
+  return parser.parse(2, args);
+}
+
+TEST(
+    error_outlives_parser,
+    {
+      auto err = orphaned_error();
+      TASSERT(err.what() == "Value 'not a number' given for -t is not valid",
+              err.what())
+      TASSERT(err.text() == "not a number", "wrong error text")
+      err = orphaned_typo();
+      TASSERT(err.suggestion() == "--threads", "suggestion lost with parser")
+
+      parser.add_argument("-t", "--threads", "a flag", false).count(1);
+      parser.parse(argc, argv);
+      err = parser.convert<int>(std::string("missing")).error();
+      TASSERT(err.what() == "Unknown argument: missing", err.what())
+
+      std::string text(1000, 'x');
+      err = ArgumentParser::Result(ArgumentParser::Result::MALFORMED_ARGUMENT,
+                                   -1, 1, StringView(), text);
+      TASSERT(err.text().size() < text.size() &&
+                  err.text() == StringView(text.data(), err.text().size()),
+              "long text not cut short")
+    }, )
+
+TEST(
+    positions_taken,
+    {
+      parser.add_argument().name("--a").positions(0, -1);
+      parser.add_argument().name("--b").positions(2, -1);
+      auto err = parser.compile();
+      TASSERT(err.code() == ArgumentParser::Result::POSITION_TAKEN,
+              "second greedy argument accepted")
+      TASSERT(err.what() == "Argument --b takes position 2, which --a "
+                            "already takes",
+              err.what())
+
+      ArgumentParser ranges("ranges", "ranges");
+      ranges.add_argument().name("--a").positions(0, -1);
+      ranges.add_argument().name("--c").positions(0, 2);
+      err = ranges.compile();
+      TASSERT(err.code() == ArgumentParser::Result::POSITION_TAKEN &&
+                  err.argument() == 1 && err.position() == 0,
+              "range inside a greedy argument accepted")
+
+      ArgumentParser overlap("overlap", "overlap");
+      overlap.add_argument().name("--c").positions(1, 2);
+      overlap.add_argument().name("--d").position(2);
+      err = overlap.compile();
+      TASSERT(err.code() == ArgumentParser::Result::POSITION_TAKEN &&
+                  err.position() == 2,
+              "overlapping ranges accepted")
+
+      ArgumentParser last("last", "last");
+      last.add_argument().name("--e").position(
+          ArgumentParser::Argument::Position::LAST);
+      last.add_argument().name("--f").position(
+          ArgumentParser::Argument::Position::LAST);
+      err = last.compile();
+      TASSERT(err.what() == "Argument --f takes the last position, which --e "
+                            "already takes",
+              err.what())
+    }, )
+
+TEST(
+    positional_ranges,
+    {
+      parser.add_argument("-v", "--verbose", "a flag", false).count(0);
+      parser.add_argument().name("--pair").positions(1, 2);
+      parser.add_argument().name("--rest").positions(3, -1);
+      parser.add_argument().name("--out").position(
+          ArgumentParser::Argument::Position::LAST);
+
+      auto err = parser.parse(argc, argv);
+      TASSERT(!err, err.what())
+      TASSERT(parser.exists("verbose"), "flag not found")
+      auto pair = parser.values("pair");
+      TASSERT(pair.size() == 2 && pair[0] == "a" && pair[1] == "b",
+              "wrong range values")
+      auto rest = parser.values("rest");
+      TASSERT(rest.size() == 3 && rest[0] == "c" && rest[1] == "-v" &&
+                  rest[2] == "d",
+              "wrong greedy values")
+      TASSERT(parser.get<std::string>("out") == "e", "wrong last value")
+      TASSERT(parser.help().find("Usage: positional_ranges [1] [pair] "
+                                 "[rest...] [options...] [out]") == 0,
+              parser.help())
+    },
+    "-v", "a", "b", "c", "-v", "d", "e")
+
+TEST(
+    positional_range_short,
+    {
+      int actions = 0;
+      parser.add_argument().name("--pair").positions(0, 2).action(
+          [&actions](const ArgumentParser::ParsedArgument&) { ++actions; });
+
+      auto err = parser.parse(argc, argv);
+      TASSERT(err.code() == ArgumentParser::Result::POSITIONAL_NOT_FOUND,
+              "range cut short accepted")
+      TASSERT(err.what() ==
+                  std::string("Argument --pair expected in position 2"),
+              err.what())
+      TASSERT(actions == 0, "action ran for a range cut short")
+
+      ArgumentParser empty("empty", "empty");
+      empty.add_argument().name("--none").positions(0, 0);
+      err = empty.compile();
+      TASSERT(err.code() == ArgumentParser::Result::POSITION_COUNT_INVALID,
+              "range without positions accepted")
+
+      ArgumentParser negative("negative", "negative");
+      negative.add_argument().name("--back").positions(0, -2);
+      err = negative.compile();
+      TASSERT(err.code() == ArgumentParser::Result::POSITION_COUNT_INVALID,
+              "negative position count accepted")
+      TASSERT(err.what() == std::string("Argument --back cannot take -2 "
+                                        "positions"),
+              err.what())
+    },
+    "a")
+
+TEST(
+    short_attached_values,
+    {
+      parser.add_argument("-j", "--jobs", "a flag", false).count(1);
+      parser.add_argument("-o", "--output", "a flag", false);
+      parser.add_argument("-x", "--extract", "a flag", false).count(0);
+      parser.add_argument("-f", "--file", "a flag", false).count(1);
+      parser.add_argument("-l", "--level", "a flag", false);
+
+      auto err = parser.parse(argc, argv);
+      TASSERT(!err, err.what())
+      TASSERT(parser.get<int>("jobs") == 8, "attached count value lost")
+      TASSERT(parser.get<std::string>("output") == "/tmp/out",
+              "attached list value lost")
+      TASSERT(parser.exists("extract"), "flag in cluster not found")
+      TASSERT(parser.get<std::string>("file") == "archive.tar",
+              "value after cluster lost")
+      TASSERT(parser.exists("level") && parser.values("level").empty(),
+              "option read as a value")
+      TASSERT(parser.get<int>("x") == 0, "flag took a value")
+    },
+    "-j8", "-o/tmp/out", "-xf", "archive.tar", "-lx")
+
+static constexpr StaticArgument short_args[] = {
+    {"-j", "--jobs", false, 1}, {"-x", "--extract", false, 0},
+    {"-f", "--file", false, 1}};
+static const char* short_argv[] = {"short", "-j8", "-xf", "archive.tar"};
+
+TEST(
+    static_short_attached_values,
+    {
+      StaticArgumentParser<3> p(short_args);
+      auto err = p.parse(4, short_argv);
+      TASSERT(!err, err.what())
+      TASSERT(p.get<int>("jobs") == 8, "attached value lost")
+      TASSERT(p.exists("x"), "flag in cluster not found")
+      TASSERT(p.value("file") == "archive.tar", "value after cluster lost")
+    }, )
+
+static const char* config_complete_argv[] = {"config_file", "__complete",
+                                             "--th"};
+
+TEST(
+    config_file,
+    {
+      scratch_file config("argparse_config.ini",
+                          "# worker settings\n"
+                          "threads = 2\n"
+                          "verbose\n"
+                          "quiet = false\n"
+                          "files = a.txt 'b c.txt'\r\n"
+                          "\n"
+                          "[log]\n"
+                          "level = 3\n");
+      int threads = 0;
+      parser.add_argument("-t", "--threads", "a flag", false)
+          .count(1)
+          .bind(threads);
+      parser.add_argument("-v", "--verbose", "a flag", false).count(0);
+      parser.add_argument("-q", "--quiet", "a flag", false).count(0);
+      parser.add_argument("-f", "--files", "a flag", false);
+      parser.add_argument("--log.level", "a flag", false).count(1);
+      parser.config_file("argparse_config.ini");
+
+      auto err = parser.parse(argc, argv);
+      TASSERT(!err, err.what())
+      TASSERT(parser.get<int>("threads") == 8 && threads == 8,
+              "command line did not take precedence")
+      TASSERT(parser.exists("verbose") && !parser.exists("quiet"),
+              "wrong config flags")
+      auto files = parser.values("files");
+      TASSERT(files.size() == 2 && files[0] == "a.txt" && files[1] == "b c.txt",
+              "wrong config list")
+      TASSERT(parser.get<int>("log.level") == 3, "wrong section value")
+      size_t before = allocations;
+      err = parser.parse(argc, argv);
+      TASSERT(!err && allocations == before, "reparse read the file again")
+      TASSERT(parser.values("files").size() == 2, "config values lost")
+
+      config.write("threads = 2\nbogus = 1\n");
+      err = parser.parse(argc, argv);
+      TASSERT(!err, "file read again without asking")
+      parser.config_file("argparse_config.ini");
+      err = parser.parse(argc, argv);
+      TASSERT(err.code() == ArgumentParser::Result::CONFIG_KEY_UNKNOWN,
+              "unknown key accepted")
+      TASSERT(err.what() == "Unknown key on line 2 of config file: bogus",
+              err.what())
+
+      parser.config_file("argparse_missing.ini");
+      err = parser.parse(argc, argv);
+      TASSERT(!err, "missing optional config file reported")
+      parser.config_file("argparse_missing.ini", true);
+      err = parser.parse(argc, argv);
+      TASSERT(err.code() == ArgumentParser::Result::CONFIG_FILE_UNREADABLE,
+              "missing required config file accepted")
+
+      // only a parse reads the file
+      config.write("bogus = 1\n");
+      parser.config_file("argparse_config.ini");
+      parser.help();
+      std::ostringstream out;
+      TASSERT(parser.complete(3, config_complete_argv, out), "not completed")
+      config.write("threads = 2\n");
+      err = parser.parse(argc, argv);
+      TASSERT(!err, "help() or complete() read the config file")
+    },
+    "-t", "8")
+
+static const char* plain_argv[] = {"test", "-v"};
+static int build_constructed = 0;
+static int clean_constructed = 0;
+
+static void build_command(ArgumentParser& p) {
+  ++build_constructed;
+  p.add_argument("-j", "--jobs", "a flag", false).count(1);
+  p.add_argument("--target", "a flag", false)
+      .position(ArgumentParser::Argument::Position::LAST);
+}
+
+static void clean_command(ArgumentParser& p) {
+  ++clean_constructed;
+  p.add_argument("-a", "--all", "a flag", false).count(0);
+}
+
+TEST(
+    subcommands,
+    {
+      parser.add_argument("-v", "--verbose", "a flag", false).count(0);
+      parser.add_subcommand("build", "Builds a target", build_command);
+      parser.add_subcommand("clean", "Removes build output", clean_command);
+      auto err = parser.parse(argc, argv);
+      TASSERT(!err, err.what())
+      TASSERT(build_constructed == 1 && clean_constructed == 0,
+              "wrong subcommands constructed")
+      TASSERT(parser.exists("verbose"), "option before subcommand lost")
+      TASSERT(parser.subcommand() == "build", "wrong subcommand")
+      const ArgumentParser::ParseResult* sub = parser.subcommand_result();
+      TASSERT(sub && sub->get<int>("jobs") == 4, "subcommand option lost")
+      TASSERT(sub->get<std::string>("target") == "all",
+              "subcommand positional lost")
+
+      err = parser.parse(argc, argv);
+      TASSERT(!err, err.what())
+      TASSERT(build_constructed == 1, "subcommand constructed twice")
+      err = parser.parse(2, plain_argv);
+      TASSERT(!err, err.what())
+      TASSERT(parser.subcommand().empty() && !parser.subcommand_result(),
+              "subcommand kept from last parse")
+      TASSERT(parser.help().find("    clean") != std::string::npos,
+              "subcommand missing from help")
+    },
+    "-v", "build", "-j", "4", "all")
+
+static void broken_command(ArgumentParser& p) {
+  p.add_argument("-v", "--verbose", "a flag", false).count(0);
+  p.add_argument("-v", "--version", "a flag", false).count(0);
+}
+
+TEST(
+    subcommand_compile_error,
+    {
+      parser.add_subcommand("run", "Runs", broken_command);
+      auto err = parser.parse(argc, argv);
+      TASSERT(err.code() == ArgumentParser::Result::DUPLICATE_NAME,
+              err.what())
+      TASSERT(parser.subcommand().empty(), "broken subcommand selected")
+    },
+    "run", "-v")
+
+static void jobs_command(ArgumentParser& p) {
+  p.add_argument("-j", "--jobs", "a flag", false).count(1);
+}
+
+static const char* complete_argv[] = {"completion", "build", "--j"};
+static const char* build_query[] = {"completion", "__complete", "build",
+                                    "--j"};
+
+TEST(
+    completion,
+    {
+      parser.add_argument("-v", "--verbose", "Talks more", false).count(0);
+      parser.add_argument("--version", "Shows the version", false).count(0);
+      parser.add_subcommand("build", "Builds a target", jobs_command);
+      parser.add_subcommand("bench", "Runs benchmarks", nullptr);
+      std::ostringstream out;
+      TASSERT(parser.complete(argc, argv, out), "query not answered")
+      TASSERT(out.str() ==
+                  "--verbose\tTalks more\n--version\tShows the version\n",
+              out.str())
+      out.str("");
+      TASSERT(!parser.complete(3, complete_argv, out),
+              "plain command line taken for a query")
+      TASSERT(out.str().empty(), "output written for a plain command line")
+      TASSERT(parser.complete(4, build_query, out), "query not answered")
+      TASSERT(out.str() == "--jobs\ta flag\n", out.str())
+      TASSERT(parser.completion_script("bash").find(
+                  "complete -o default -F _completion_complete completion") !=
+                  std::string::npos,
+              parser.completion_script("bash"))
+      TASSERT(!parser.completion_script("zsh").empty() &&
+                  !parser.completion_script("fish").empty(),
+              "missing script")
+      TASSERT(parser.completion_script("csh").empty(), "unknown shell")
+      TASSERT(parser.completion_script("fish").find("\"$cur\"") !=
+                  std::string::npos,
+              parser.completion_script("fish"))
+
+      ArgumentParser broken("broken", "broken");
+      broken.add_argument("-v", "--verbose", "a flag", false);
+      broken.add_argument("-v", "--version", "a flag", false);
+      std::ostringstream errors;
+      std::streambuf* cerr = std::cerr.rdbuf(errors.rdbuf());
+      out.str("");
+      bool answered = broken.complete(argc, argv, out);
+      std::cerr.rdbuf(cerr);
+      TASSERT(answered && out.str().empty(), "broken parser offered names")
+      TASSERT(errors.str() == "Duplicate of argument name: -v\n",
+              errors.str())
+    },
+    "__complete", "--ver")
+
+static const char* copy_argv[] = {"copy", "-v", "build", "-j", "2"};
+static const char* copy_query[] = {"copy", "__complete", "--ver"};
+
+TEST(
+    copied_parser,
+    {
+      ArgumentParser* original = new ArgumentParser("original", "original");
+      original->add_argument("-v", "--verbose", "Talks more", false).count(0);
+      original->add_argument("--version", "Shows the version", false)
+          .count(0);
+      original->add_subcommand("build", "Builds a target", jobs_command);
+      auto err = original->parse(5, copy_argv);
+      TASSERT(!err, err.what())
+      ArgumentParser copy(*original);
+      parser.add_argument("-x", "--extra", "a flag", false);
+      parser = *original;
+      delete original;
+
+      TASSERT(!copy.exists("verbose"), "copy shares the parse it was made of")
+      std::ostringstream out;
+      TASSERT(copy.complete(3, copy_query, out), "query not answered")
+      TASSERT(out.str() ==
+                  "--verbose\tTalks more\n--version\tShows the version\n",
+              out.str())
+      err = copy.parse(5, copy_argv);
+      TASSERT(!err, err.what())
+      TASSERT(copy.exists("verbose") && copy.subcommand() == "build" &&
+                  copy.subcommand_result()->get<int>("jobs") == 2,
+              "copy parsed wrong")
+
+      err = parser.parse(5, copy_argv);
+      TASSERT(!err, err.what())
+      TASSERT(parser.exists("v") && !parser.exists("extra"),
+              "assigned parser kept its own arguments")
+      TASSERT(parser.help().find("--version") != std::string::npos,
+              parser.help())
+    }, )
+
+static const char* typo_argv[] = {"suggestions", "--thraeds", "4"};
+static constexpr StaticArgument typo_args[] = {{"-o", "--output", false, 1},
+                                               {"-v", "--verbose", false, 0}};
+
+TEST(
+    suggestions,
+    {
+      parser.add_argument("-t", "--threads", "a flag", false).count(1);
+      parser.add_argument("-v", "--verbose", "a flag", false).count(0);
+      auto err = parser.parse(argc, argv);
+      TASSERT(err.code() == ArgumentParser::Result::UNRECOGNIZED_OPTION,
+              "wrong error code")
+      TASSERT(err.suggestion() == "--verbose", err.suggestion())
+      TASSERT(err.what() ==
+                  "Unrecognized command line option 'verbos', did you mean "
+                  "'--verbose'?",
+              err.what())
+      err = parser.parse(3, typo_argv);
+      TASSERT(err.suggestion() == "--threads", err.suggestion())
+      err = parser.parse(2, error_argv + 2);
+      TASSERT(err.suggestion().empty(), err.suggestion())
+
+      StaticArgumentParser<2> p(typo_args);
+      err = p.parse(2, argv);
+      TASSERT(err.what() ==
+                  "Unrecognized command line option 'verbos', did you mean "
+                  "'--verbose'?",
+              err.what())
+    },
+    "--verbos")
+
+TEST(
+    parse_stats,
+    {
+      parser.add_argument("-t", "--threads", "a flag", false).count(1);
+      parser.add_argument("-v", "--verbose", "a flag", false).count(0);
+      parser.add_argument("-f", "--files", "a flag", false);
+      ArgumentParser::ParseStats stats;
+      parser.collect_stats(&stats);
+      auto err = parser.parse(argc, argv);
+      TASSERT(!err, err.what())
+      TASSERT(stats.parses == 1 && stats.tokens == 6, "wrong token count")
+      TASSERT(stats.lookups == 3, "wrong lookup count")
+      TASSERT(stats.values == 3, "wrong value count")
+      TASSERT(stats.allocated_bytes > 0 &&
+                  stats.retained_bytes > stats.allocated_bytes,
+              "memory not counted")
+      TASSERT(parser.get<int>("threads") == 4 && stats.lookups == 4,
+              "get not counted")
+
+      size_t allocated = stats.allocated_bytes;
+      err = parser.parse(argc, argv);
+      TASSERT(!err, err.what())
+      TASSERT(stats.parses == 2 && stats.tokens == 12 && stats.values == 6,
+              "counts not added up")
+      TASSERT(stats.allocated_bytes == allocated, "reparse allocated")
+
+      parser.collect_stats(nullptr);
+      parser.parse(argc, argv);
+      parser.get<int>("threads");
+      TASSERT(stats.parses == 2 && stats.lookups == 7,
+              "counted with stats off")
+    },
+    "-t", "4", "-v", "--files", "a", "b")
+
+static const char* budget_argv[] = {"budget", "-t", "4", "--files", "a", "b"};
+
+static void feed_budget_argv(const ArgumentParser& parser,
+                             ArgumentParser::ParseResult& result) {
+  parser.begin(result);
+  for (int i = 1; i < 6; ++i) {
+    parser.feed(result, budget_argv[i]);
+  }
+  parser.finish(result);
+}
+
+// Allocations made by each step once a compiled parser has parsed the same
+// command line before: reparsing, looking up and converting scalars must
+// not allocate beyond caching a converted value once per parse
+TEST(
+    allocation_budget,
+    {
+      parser.add_argument("-t", "--threads", "a flag", false).count(1);
+      parser.add_argument("-v", "--verbose", "a flag", false).count(0);
+      parser.add_argument("-f", "--files", "a flag", false);
+      parser.compile();
+      parser.parse(argc, argv);
+      parser.get<int>("threads");
+
+      size_t before = allocations;
+      auto err = parser.parse(argc, argv);
+      TASSERT(!err && allocations == before, "reparse allocated")
+      bool found = parser.exists("verbose") && parser.exists("files");
+      TASSERT(found && allocations == before, "exists allocated")
+      int threads = parser.get<int>("threads");
+      TASSERT(threads == 4 && allocations == before + 1,
+              "get allocated more than the cached value")
+      threads = parser.get<int>("threads");
+      TASSERT(allocations == before + 1, "cached get allocated")
+      auto c = parser.convert<int>("threads");
+      TASSERT(c.ok() && allocations == before + 1, "convert allocated")
+      before = allocations;
+      auto &files = parser.ref<std::vector<std::string>>("files");
+      TASSERT(files.size() == 2 && allocations == before + 2,
+              "ref of a vector over budget")
+      before = allocations;
+      TASSERT(&parser.ref<std::vector<std::string>>("files") == &files &&
+                  allocations == before,
+              "cached ref allocated")
+
+      ArgumentParser::ParseResult result;
+      parser.parse(6, budget_argv, result);
+      before = allocations;
+      err = parser.parse(6, budget_argv, result);
+      TASSERT(!err && allocations == before, "reparse into a result allocated")
+      Arena arena;
+      ArgumentParser::ParseResult arena_result(arena);
+      parser.parse(6, budget_argv, arena_result);
+      before = allocations;
+      err = parser.parse(6, budget_argv, arena_result);
+      TASSERT(!err && allocations == before, "reparse into an arena allocated")
+      feed_budget_argv(parser, result);
+      before = allocations;
+      feed_budget_argv(parser, result);
+      TASSERT(result.exists("files") && allocations == before,
+              "reparse of fed tokens allocated")
+    },
+    "-t", "4", "-v", "--files", "a", "b")
+
+static std::vector<std::string> number_tokens(size_t n) {
+  std::vector<std::string> tokens;
+  for (size_t i = 0; i < n; ++i) {
+    tokens.push_back(std::to_string(i * 12345679));
+  }
+  return tokens;
+}
+
+TEST(
+    bulk_conversion,
+    {
+      parser.add_argument("-w", "--weights", "a flag", false);
+      parser.add_argument("-n", "--numbers", "a flag", false)
+          .conversion_threads(4);
+      std::vector<std::string> tokens = number_tokens(40000);
+      std::vector<const char*> args(1, "bulk");
+      args.push_back("--weights");
+      args.push_back("0.1");
+      args.push_back("-2.5");
+      args.push_back("3");
+      args.push_back("1e-3");
+      args.push_back("--numbers");
+      for (auto& t : tokens) {
+        args.push_back(t.c_str());
+      }
+      auto err = parser.parse(static_cast<int>(args.size()), args.data());
+      TASSERT(!err, err.what())
+
+      size_t before = allocations;
+      auto &weights = parser.ref<std::vector<double>>("weights");
+      TASSERT(allocations == before + 2, "list conversion over budget")
+      TASSERT(weights.size() == 4 &&
+                  std::abs(weights[0] - 0.1) < 0.0000000001 &&
+                  std::abs(weights[1] + 2.5) < 0.0000000001 &&
+                  std::abs(weights[2] - 3) < 0.0000000001 &&
+                  std::abs(weights[3] - 0.001) < 0.0000000001,
+              "wrong weights")
+      auto numbers = parser.get<std::vector<long long>>("numbers");
+      bool all = numbers.size() == tokens.size();
+      for (size_t i = 0; all && i < numbers.size(); ++i) {
+        all = numbers[i] == static_cast<long long>(i) * 12345679;
+      }
+      TASSERT(all, "wrong numbers")
+
+      tokens[35000] = "1x";
+      tokens[30000] = "99999999999999999999";
+      tokens[2] = "2";
+      args.resize(7);
+      for (auto& t : tokens) {
+        args.push_back(t.c_str());
+      }
+      parser.parse(static_cast<int>(args.size()), args.data());
+      auto c = parser.convert<std::vector<long long>>("numbers");
+      TASSERT(c.error().code() == ArgumentParser::Result::VALUE_OUT_OF_RANGE &&
+                  c.error().position() == 30000,
+              "wrong failing value")
+      numbers = parser.get<std::vector<long long>>("numbers");
+      TASSERT(numbers[2] == 2 && numbers[30000] == 0 && numbers[35000] == 0 &&
+                  numbers[39999] == 39999LL * 12345679,
+              "failing values not left at zero")
+    }, )
+
 #define TT(name) \
   { #name, name }
 using test = std::function<result()>;
@@ -404,11 +1713,49 @@ int main(int argc, const char* argv[]) {
       TT(arg_count_more),
       TT(arg_count_less),
       TT(arg_count_zero),
+      TT(free_values),
       TT(positional_argument_found),
       TT(positional_argument_not_found),
       TT(positional_argument_overrun),
       TT(positional_argument_last),
-      TT(positional_argument_last_override)};
+      TT(positional_argument_last_override),
+      TT(zero_copy_values),
+      TT(many_options),
+      TT(duplicate_name),
+      TT(static_parser),
+      TT(static_parser_required),
+      TT(typed_conversion),
+      TT(checked_conversion),
+      TT(locale_independent_conversion),
+      TT(cached_values),
+      TT(dashed_names),
+      TT(reuse_parser),
+      TT(concurrent_parse_results),
+      TT(concurrent_get),
+      TT(batch_parse),
+      TT(response_file),
+      TT(response_file_cycle),
+      TT(stream_parse),
+      TT(stream_not_begun),
+      TT(bind_and_action),
+      TT(arena_parse),
+      TT(help_text),
+      TT(error_codes),
+      TT(error_outlives_parser),
+      TT(positions_taken),
+      TT(positional_ranges),
+      TT(positional_range_short),
+      TT(short_attached_values),
+      TT(static_short_attached_values),
+      TT(config_file),
+      TT(subcommands),
+      TT(subcommand_compile_error),
+      TT(completion),
+      TT(copied_parser),
+      TT(suggestions),
+      TT(parse_stats),
+      TT(allocation_budget),
+      TT(bulk_conversion)};
 
   std::vector<result> results;
   size_t passed = 0;